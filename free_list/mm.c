@@ -7,6 +7,7 @@
 #include <sys/mman.h>
 
 #include "mm.h"
+#include "mm_profile.h"
 
 typedef uint64_t header;
 
@@ -17,27 +18,49 @@ typedef uint64_t header;
 #define BLOCK_ALLOCATED(header_ptr) (*(uint64_t *) header_ptr & 1)
 #define BLOCK_FOOTER(header_ptr) ((char *)(header_ptr) + BLOCK_SIZE(header_ptr) - HEADER_SIZE)
 #define PREV_BLOCK_ALLOCATED(header_ptr) ((*(uint64_t *) header_ptr & 2) >> 1)
+#define BLOCK_SAMPLED(header_ptr) (*(uint64_t *) header_ptr & 4)
 #define NEXT_BLOCK(header_ptr)((char *)(header_ptr) + BLOCK_SIZE(header_ptr))
 
 void *area;
+int placement;
+void *rover; /* next-fit: where the previous search stopped */
 
 void set_header(void *header, int size, bool allocated, bool prev_allocated)
 {
     *(uint64_t *)header = size | allocated | (prev_allocated << 1);
 }
 
+void set_prev_allocated(void *header, bool prev_allocated)
+{
+    *(uint64_t *)header = (*(uint64_t *)header & ~2) | (prev_allocated << 1);
+}
+
+void set_sampled(void *header)
+{
+    *(uint64_t *)header |= 4;
+}
+
 void set_footer(void *footer, int size)
 {
     *(uint64_t *)footer = size;
 }
 
 void mm_init(void *heap, size_t heap_size)
+{
+  mm_init_policy(heap, heap_size, MM_FIRST_FIT);
+}
+
+void mm_init_policy(void *heap, size_t heap_size, int policy)
 { 
   area = heap + HEADER_SIZE;
   heap_size = heap_size - 2 * HEADER_SIZE;
   set_header(area, heap_size, false, true);
   set_header(NEXT_BLOCK(area), 0, true, true);
 
+  placement = policy;
+  rover = area;
+
+  mm_profile_reset();
 }
 
 void *find_free_block(void *heap, size_t size)
@@ -63,6 +86,54 @@ void *find_free_block(void *heap, size_t size)
     };
 }
 
+void *find_next_fit(size_t size)
+{
+    void *block = rover;
+
+    /* from the rover to the end of the heap, then wrap around */
+    while (BLOCK_SIZE(block) != 0)
+    {
+        if (BLOCK_ALLOCATED(block) == false && BLOCK_SIZE(block) >= size)
+        {
+            return block;
+        }
+        block = NEXT_BLOCK(block);
+    }
+
+    for (block = area; block != rover; block = NEXT_BLOCK(block))
+    {
+        if (BLOCK_ALLOCATED(block) == false && BLOCK_SIZE(block) >= size)
+        {
+            return block;
+        }
+    }
+    return NULL;
+}
+
+void *find_best_fit(void *heap, size_t size)
+{
+    size_t block_size;
+    void *best = NULL;
+    void *block;
+
+    for (block = heap; (block_size = BLOCK_SIZE(block)) != 0; block = NEXT_BLOCK(block))
+    {
+        if (BLOCK_ALLOCATED(block) == true || block_size < size)
+        {
+            continue;
+        }
+        if (block_size == size)
+        {
+            return block;
+        }
+        if (best == NULL || block_size < BLOCK_SIZE(best))
+        {
+            best = block;
+        }
+    }
+    return best;
+}
+
 void print_fragment(void *heap)
 {
     void *head = heap;
@@ -93,7 +164,19 @@ void *mm_malloc(size_t size)
   }
 
   int aligned_size = ALIGN(size + HEADER_SIZE);
-  void *block = find_free_block(area, aligned_size);
+  void *block;
+
+  switch (placement)
+  {
+  case MM_NEXT_FIT:
+    block = find_next_fit(aligned_size);
+    break;
+  case MM_BEST_FIT:
+    block = find_best_fit(area, aligned_size);
+    break;
+  default:
+    block = find_free_block(area, aligned_size);
+  }
 
   if (block == NULL)
   {
@@ -112,9 +195,20 @@ void *mm_malloc(size_t size)
   } else {
     void *next_header = NEXT_BLOCK(block);
     set_header(block, BLOCK_SIZE(block), true, PREV_BLOCK_ALLOCATED(block));
-    set_header(next_header, BLOCK_SIZE(next_header), BLOCK_ALLOCATED(next_header), true);
+    set_prev_allocated(next_header, true);
+  }
+
+  if (mm_profile_rate != 0)
+  {
+    mm_profile_countdown -= size;
+    if (mm_profile_countdown <= 0 && mm_profile_record(block, size))
+    {
+      set_sampled(block);
+    }
   }
 
+  rover = NEXT_BLOCK(block);
+
   return (char *)(block) + HEADER_SIZE;
 }
 
@@ -162,6 +256,12 @@ void coalesce_blocks(void *block)
       
     } else {
     }
+
+    /* keep the rover on a block header when its block was merged away */
+    if ((char *)rover > (char *)block && (char *)rover < (char *)NEXT_BLOCK(block))
+    {
+        rover = block;
+    }
 }
 
 void mm_free(void *payload)
@@ -171,13 +271,17 @@ void mm_free(void *payload)
       return;
   }
   void *header = (char *)payload - HEADER_SIZE;
+  if (BLOCK_SAMPLED(header))
+  {
+    mm_profile_retire(header);
+  }
   set_header(header, BLOCK_SIZE(header), false, PREV_BLOCK_ALLOCATED(header));
   
   void *footer = BLOCK_FOOTER(header);
   set_footer(footer, BLOCK_SIZE(header));
 
   void *next = NEXT_BLOCK(header);
-  set_header(next, BLOCK_SIZE(next), BLOCK_ALLOCATED(next), false);
+  set_prev_allocated(next, false);
 
   coalesce_blocks(header);
 }
@@ -1,5 +1,33 @@
 #include <stdio.h>
 
+/* placement policies for mm_init_policy(); mm_init() uses first-fit */
+#define MM_FIRST_FIT 0
+#define MM_NEXT_FIT 1
+#define MM_BEST_FIT 2
+
 extern void mm_init(void *heap, size_t heap_size);
+extern void mm_init_policy(void *heap, size_t heap_size, int policy);
 extern void *mm_malloc(size_t size);
 extern void mm_free(void *ptr);
+
+/*
+ * Sampling heap profiler. While started, roughly one block per
+ * sample_bytes allocated has its call stack recorded; mm_free() retires
+ * it. mm_profile_dump() prints the sampled live heap by call site.
+ * live_bytes is the estimated size of the live heap the samples stand
+ * for; mm_profile_live_from() counts the live samples allocated with
+ * function on the stack. Functions are found with dladdr(), so they must
+ * be exported (non-static, linked with -rdynamic).
+ */
+struct mm_profile_stats {
+  int live_samples;
+  double live_bytes;
+  long taken_samples;
+  long dropped_samples;
+};
+
+extern void mm_profile_start(size_t sample_bytes);
+extern void mm_profile_stop(void);
+extern void mm_profile_stats(struct mm_profile_stats *stats);
+extern int mm_profile_live_from(void *function);
+extern void mm_profile_dump(FILE *out);
@@ -0,0 +1,204 @@
+#define _GNU_SOURCE /* dladdr */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include <execinfo.h>
+#include <dlfcn.h>
+
+#include "mm.h"
+#include "mm_profile.h"
+
+#define MAX_SAMPLES 4096
+#define MAX_DEPTH 16
+#define SKIP_FRAMES 2 /* mm_profile_record and mm_malloc */
+
+struct sample {
+  void *block;
+  size_t size;
+  double weight; /* estimated bytes this sample stands for */
+  int depth;
+  void *frames[MAX_DEPTH];
+};
+
+size_t mm_profile_rate;
+long mm_profile_countdown;
+
+static struct sample samples[MAX_SAMPLES];
+static int live_samples;
+static long taken_samples;
+static long dropped_samples; /* not recorded because the table was full */
+static unsigned int seed = 1;
+
+/* exponentially distributed gaps make the sampled sizes unbiased */
+static long next_countdown(void)
+{
+  double u = (rand_r(&seed) + 1.0) / (RAND_MAX + 2.0);
+  return (long)(-log(u) * mm_profile_rate) + 1;
+}
+
+void mm_profile_start(size_t sample_bytes)
+{
+  mm_profile_rate = sample_bytes;
+  if (sample_bytes != 0)
+  {
+    mm_profile_countdown = next_countdown();
+  }
+}
+
+void mm_profile_stop(void)
+{
+  mm_profile_rate = 0;
+}
+
+void mm_profile_reset(void)
+{
+  live_samples = 0;
+}
+
+bool mm_profile_record(void *block, size_t size)
+{
+  struct sample *sample;
+  void *frames[MAX_DEPTH + SKIP_FRAMES];
+  int depth;
+
+  mm_profile_countdown = next_countdown();
+
+  if (live_samples == MAX_SAMPLES)
+  {
+    dropped_samples++;
+    return false;
+  }
+  taken_samples++;
+
+  sample = &samples[live_samples++];
+  sample->block = block;
+  sample->size = size;
+  sample->weight = size / (1 - exp(-(double)size / mm_profile_rate));
+
+  depth = backtrace(frames, MAX_DEPTH + SKIP_FRAMES);
+  sample->depth = depth > SKIP_FRAMES ? depth - SKIP_FRAMES : 0;
+  memcpy(sample->frames, frames + SKIP_FRAMES, sample->depth * sizeof(void *));
+
+  return true;
+}
+
+void mm_profile_retire(void *block)
+{
+  int i;
+
+  for (i = 0; i < live_samples; i++)
+  {
+    if (samples[i].block == block)
+    {
+      samples[i] = samples[--live_samples];
+      return;
+    }
+  }
+}
+
+void mm_profile_stats(struct mm_profile_stats *stats)
+{
+  int i;
+
+  stats->live_samples = live_samples;
+  stats->live_bytes = 0;
+  for (i = 0; i < live_samples; i++)
+  {
+    stats->live_bytes += samples[i].weight;
+  }
+  stats->taken_samples = taken_samples;
+  stats->dropped_samples = dropped_samples;
+}
+
+int mm_profile_live_from(void *function)
+{
+  Dl_info info;
+  int count = 0;
+  int i, j;
+
+  for (i = 0; i < live_samples; i++)
+  {
+    for (j = 0; j < samples[i].depth; j++)
+    {
+      /* a frame is a return address inside its caller */
+      if (dladdr(samples[i].frames[j], &info) && info.dli_saddr == function)
+      {
+        count++;
+        break;
+      }
+    }
+  }
+  return count;
+}
+
+struct site {
+  double weight;
+  int count;
+  int depth;
+  void **frames;
+};
+
+static struct site sites[MAX_SAMPLES];
+
+static int compare_sites(const void *a, const void *b)
+{
+  const struct site *x = a, *y = b;
+  return (x->weight < y->weight) - (x->weight > y->weight);
+}
+
+void mm_profile_dump(FILE *out)
+{
+  struct sample *sample;
+  int nsites = 0;
+  double total = 0;
+  char **symbols;
+  int i, j;
+
+  /* fold samples with the same call stack into one site */
+  for (i = 0; i < live_samples; i++)
+  {
+    sample = &samples[i];
+    total += sample->weight;
+    for (j = 0; j < nsites; j++)
+    {
+      if (sites[j].depth == sample->depth
+          && !memcmp(sites[j].frames, sample->frames, sample->depth * sizeof(void *)))
+        break;
+    }
+    if (j == nsites)
+    {
+      sites[nsites].weight = 0;
+      sites[nsites].count = 0;
+      sites[nsites].depth = sample->depth;
+      sites[nsites].frames = sample->frames;
+      nsites++;
+    }
+    sites[j].weight += sample->weight;
+    sites[j].count++;
+  }
+  qsort(sites, nsites, sizeof(struct site), compare_sites);
+
+  fprintf(out, "heap profile: %d samples, %.0f bytes live (1 sample per %zu bytes)\n",
+          live_samples, total, mm_profile_rate);
+  fprintf(out, "  %ld samples taken, %ld dropped because the %d-entry sample table was full\n",
+          taken_samples, dropped_samples, MAX_SAMPLES);
+  for (i = 0; i < nsites; i++)
+  {
+    fprintf(out, "%12.0f %6d @", sites[i].weight, sites[i].count);
+    for (j = 0; j < sites[i].depth; j++)
+    {
+      fprintf(out, " %p", sites[i].frames[j]);
+    }
+    fprintf(out, "\n");
+
+    symbols = backtrace_symbols(sites[i].frames, sites[i].depth);
+    for (j = 0; symbols && j < sites[i].depth; j++)
+    {
+      fprintf(out, "    %s\n", symbols[j]);
+    }
+    free(symbols);
+  }
+}
@@ -0,0 +1,10 @@
+#include <stdbool.h>
+#include <stddef.h>
+
+/* internal hooks between mm.c and mm_profile.c */
+extern size_t mm_profile_rate;
+extern long mm_profile_countdown;
+
+extern bool mm_profile_record(void *block, size_t size);
+extern void mm_profile_retire(void *block);
+extern void mm_profile_reset(void);
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 #include <unistd.h>
 #include <sys/mman.h>
 #include <sys/resource.h>
@@ -12,6 +13,23 @@ static void alloc_excessive(int n, int s, int iters, int compact);
 static void alloc_shrinking(int n, int s, int iters, int compact);
 static void alloc_growing(int n, int s, int iters, int compact);
 static void alloc_timing(int n, int s, int iters, int compact);
+static void alloc_profiled(int n, int s, int iters, int compact);
+static void alloc_touch(int n, int s, int iters, int compact);
+static long now();
+
+/* heap mapping options, see init_heap() */
+#define HEAP_HUGEPAGE 0x1
+#define HEAP_HUGETLB  0x2
+#define HEAP_POPULATE 0x4
+
+#define HUGE_PAGE_SIZE (2L << 20)
+
+static int heap_flags;
+
+static int policy = MM_FIRST_FIT;
+static int profile_bytes;
+static int profiling; /* --profile given, even with 0 to time a baseline */
+static void compare_policies(int n, int s, int iters, int compact);
 
 int main(int argc, char **argv)
 {
@@ -20,6 +38,8 @@ int main(int argc, char **argv)
   int s = 16;
   int iters = 10;
   int compact = 0;
+  long profile_time = 0;
+  struct mm_profile_stats stats;
   int i;
 
   for (i = 1; i < argc; i++) {
@@ -58,6 +78,40 @@ int main(int argc, char **argv)
       i++;
     } else if (!strcmp(argv[i], "--compact")) {
       compact = 1;
+    } else if (!strcmp(argv[i], "--policy")) {
+      if (i+1 >= argc) {
+        fprintf(stderr, "%s: missing policy argument for --policy\n", argv[0]);
+        exit(1);
+      }
+      if (!strcmp(argv[i+1], "first"))
+        policy = MM_FIRST_FIT;
+      else if (!strcmp(argv[i+1], "next"))
+        policy = MM_NEXT_FIT;
+      else if (!strcmp(argv[i+1], "best"))
+        policy = MM_BEST_FIT;
+      else {
+        fprintf(stderr, "%s: policy must be first, next or best\n", argv[0]);
+        exit(1);
+      }
+      i++;
+    } else if (!strcmp(argv[i], "--profile")) {
+      if (i+1 >= argc) {
+        fprintf(stderr, "%s: missing number argument for --profile\n", argv[0]);
+        exit(1);
+      }
+      profile_bytes = atoi(argv[i+1]);
+      profiling = 1;
+      if (profile_bytes < 0) {
+        fprintf(stderr, "%s: number after --profile cannot be negative\n", argv[0]);
+        exit(1);
+      }
+      i++;
+    } else if (!strcmp(argv[i], "--thp")) {
+      heap_flags |= HEAP_HUGEPAGE;
+    } else if (!strcmp(argv[i], "--hugetlb")) {
+      heap_flags |= HEAP_HUGETLB;
+    } else if (!strcmp(argv[i], "--populate")) {
+      heap_flags |= HEAP_POPULATE;
     } else if (!strcmp(argv[i], "--single")) {
       which = "single";
     } else if (!strcmp(argv[i], "--singles")) {
@@ -70,6 +124,12 @@ int main(int argc, char **argv)
       which = "growing";
     } else if (!strcmp(argv[i], "--timing")) {
       which = "timing";
+    } else if (!strcmp(argv[i], "--compare")) {
+      which = "compare";
+    } else if (!strcmp(argv[i], "--profiled")) {
+      which = "profiled";
+    } else if (!strcmp(argv[i], "--touch")) {
+      which = "touch";
     } else {
       fprintf(stderr, "%s: unrecognized argument: %s\n", argv[0], argv[i]);
       exit(1);
@@ -78,7 +138,7 @@ int main(int argc, char **argv)
 
   if (!which) {
     fprintf(stderr, ("%s: select a test: --single, --singles, --excessive,"
-                     " --shrinking, --growing, or --timing\n"),
+                     " --shrinking, --growing, --timing, --compare, --profiled, or --touch\n"),
             argv[0]);
     exit(1);
   }
@@ -86,6 +146,11 @@ int main(int argc, char **argv)
   printf("Running %s with n=%d, s=%d, iters=%d\n", which, n, s, iters);
   fflush(stdout);
 
+  if (profiling) {
+    mm_profile_start(profile_bytes);
+    profile_time = now();
+  }
+
   if (!strcmp(which, "single"))
     alloc_single(n, s, iters, compact);
   else if (!strcmp(which, "singles"))
@@ -98,6 +163,25 @@ int main(int argc, char **argv)
     alloc_growing(n, s, iters, compact);
   else if (!strcmp(which, "timing"))
     alloc_timing(n, s, iters, compact);
+  else if (!strcmp(which, "compare"))
+    compare_policies(n, s, iters, compact);
+  else if (!strcmp(which, "profiled"))
+    alloc_profiled(n, s, iters, compact);
+  else if (!strcmp(which, "touch"))
+    alloc_touch(n, s, iters, compact);
+
+  if (profiling) {
+    profile_time = now() - profile_time;
+    printf("%s took %ld ms with sampling every %d bytes\n", which, profile_time, profile_bytes);
+    if (profile_bytes) {
+      mm_profile_stats(&stats);
+      if (stats.live_samples)
+        mm_profile_dump(stdout);
+      else
+        printf("no sampled blocks live; %ld samples taken, %ld dropped\n",
+               stats.taken_samples, stats.dropped_samples);
+    }
+  }
 
   printf("Passed\n");
   
@@ -116,6 +200,7 @@ int main(int argc, char **argv)
 
 static void  *the_heap;
 static size_t the_heap_size;
+static size_t the_heap_peak; /* highest heap offset handed out */
 
 static void fill(void *p, int key, int s)
 {
@@ -169,6 +254,9 @@ static void *checked_malloc(size_t s, int fail_ok)
             p, p+s, the_heap, the_heap + the_heap_size);
     exit(1);
   }
+
+  if ((p+s) - the_heap > the_heap_peak)
+    the_heap_peak = (p+s) - the_heap;
   
   return p;
 }
@@ -179,23 +267,59 @@ static void init_heap(int n, int min_size, int total_size, int compact)
   long overhead = (compact ? 16 : 32);
   long heap_size = (n * (overhead + max_pad)) + total_size + 64;
   long ps = getpagesize();
+  int map_flags = MAP_PRIVATE | MAP_ANON;
   void *heap;
 
-  /* round up to page size: */
-  heap_size = (heap_size + (ps - 1)) & ~(ps-1);
+  if (heap_flags & HEAP_POPULATE)
+    map_flags |= MAP_POPULATE;
 
-  /* add pre and post page */
-  heap = mmap(0, heap_size + ps*2, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+  if (heap_flags & HEAP_HUGETLB) {
+    void *reserve;
 
-  /* make pre and post page unreadable and unwritable */
-  mprotect(heap, ps, 0);
-  heap += ps;
-  mprotect(heap+heap_size, ps, 0);
+    /* round up to huge page size: */
+    heap_size = (heap_size + (HUGE_PAGE_SIZE - 1)) & ~(HUGE_PAGE_SIZE-1);
 
-  mm_init(heap, heap_size);
+    /* huge pages can't be protected 4k at a time, so reserve an
+       inaccessible area and map the aligned heap into its middle */
+    reserve = mmap(0, heap_size + HUGE_PAGE_SIZE*3, PROT_NONE,
+                   MAP_PRIVATE | MAP_ANON | MAP_NORESERVE, -1, 0);
+    if (reserve == MAP_FAILED) {
+      perror("init_heap: reserve");
+      exit(1);
+    }
+    heap = (void *)(((long)reserve + HUGE_PAGE_SIZE*2 - 1) & ~(HUGE_PAGE_SIZE-1));
+
+    if (mmap(heap, heap_size, PROT_READ | PROT_WRITE, map_flags | MAP_FIXED | MAP_HUGETLB, -1, 0)
+        == MAP_FAILED) {
+      /* no huge pages reserved: fall back to normal pages */
+      fprintf(stderr, "init_heap: MAP_HUGETLB failed, using normal pages\n");
+      if (mmap(heap, heap_size, PROT_READ | PROT_WRITE, map_flags | MAP_FIXED, -1, 0)
+          == MAP_FAILED) {
+        perror("init_heap");
+        exit(1);
+      }
+    }
+  } else {
+    /* round up to page size: */
+    heap_size = (heap_size + (ps - 1)) & ~(ps-1);
+
+    /* add pre and post page */
+    heap = mmap(0, heap_size + ps*2, PROT_READ | PROT_WRITE, map_flags, -1, 0);
+
+    /* make pre and post page unreadable and unwritable */
+    mprotect(heap, ps, 0);
+    heap += ps;
+    mprotect(heap+heap_size, ps, 0);
+  }
+
+  if (heap_flags & HEAP_HUGEPAGE)
+    madvise(heap, heap_size, MADV_HUGEPAGE);
+
+  mm_init_policy(heap, heap_size, policy);
 
   the_heap = heap;
   the_heap_size = heap_size;
+  the_heap_peak = 0;
 }
 
 static long now()
@@ -573,3 +697,149 @@ void alloc_timing(int n, int s, int iters, int compact)
     exit(1);
   }
 }
+
+/*************************************************************/
+/* compare: run every scenario above under each placement    */
+/*          policy, reporting the time taken and the peak    */
+/*          heap offset used. timing runs its workload once  */
+/*          without the constant-time check.                 */
+/*************************************************************/
+
+void compare_policies(int n, int s, int iters, int compact)
+{
+  static const char *policies[] = { "first", "next", "best" };
+  static const struct {
+    const char *name;
+    void (*run)(int n, int s, int iters, int compact);
+  } scenarios[] = {
+    { "single", alloc_single },
+    { "singles", alloc_singles },
+    { "excessive", alloc_excessive },
+    { "shrinking", alloc_shrinking },
+    { "growing", alloc_growing },
+    { "timing", do_alloc_timing },
+  };
+  long time;
+  int i, j;
+
+  printf("%-10s %-6s %8s %10s %10s\n", "scenario", "policy", "ms", "peak", "heap");
+  for (i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+    for (j = 0; j < 3; j++) {
+      policy = j;
+      time = now();
+      scenarios[i].run(n, s, iters, compact);
+      time = now() - time;
+      printf("%-10s %-6s %8ld %10zu %10zu\n",
+             scenarios[i].name, policies[j], time, the_heap_peak, the_heap_size);
+    }
+  }
+}
+
+/*************************************************************/
+/* profiled: allocate n objects of size s and n objects of   */
+/*           size 4*s from two call sites, free the first    */
+/*           ones and check that the sampled live heap only  */
+/*           shows the second site, at about n*4*s bytes.    */
+/*           The sites are not static so the profile can     */
+/*           name them.                                      */
+/*************************************************************/
+
+void *profiled_small(int s)
+{
+  return checked_malloc(s, 0);
+}
+
+void *profiled_large(int s)
+{
+  return checked_malloc(4*s, 0);
+}
+
+void alloc_profiled(int n, int s, int iters, int compact)
+{
+  struct mm_profile_stats stats;
+  int rate = profile_bytes ? profile_bytes : 1024;
+  double expected = (double)n * 4 * s;
+  double tolerance;
+  int i;
+  void *small[n], *large[n];
+
+  init_heap(2*n, s, n*5*s, compact);
+  if (!profile_bytes)
+    mm_profile_start(rate);
+
+  for (i = 0; i < n; i++) {
+    small[i] = profiled_small(s);
+    large[i] = profiled_large(s);
+  }
+  for (i = 0; i < n; i++)
+    mm_free(small[i]);
+
+  mm_profile_dump(stdout);
+  mm_profile_stats(&stats);
+  if (mm_profile_live_from(profiled_large) != stats.live_samples) {
+    fprintf(stderr, "%d of %d live samples are not from profiled_large\n",
+            stats.live_samples - mm_profile_live_from(profiled_large), stats.live_samples);
+    exit(1);
+  }
+  /* about five standard deviations of the sampled estimate */
+  tolerance = expected * (0.05 + 5 / sqrt(expected / rate + 1));
+  if (!stats.dropped_samples && fabs(stats.live_bytes - expected) > tolerance) {
+    fprintf(stderr, "profile estimates %.0f live bytes, expected %.0f +- %.0f\n",
+            stats.live_bytes, expected, tolerance);
+    exit(1);
+  }
+
+  for (i = 0; i < n; i++)
+    mm_free(large[i]);
+  mm_profile_stop();
+
+  mm_profile_stats(&stats);
+  if (stats.live_samples != 0) {
+    fprintf(stderr, "%d samples still live after freeing everything\n", stats.live_samples);
+    exit(1);
+  }
+}
+
+/*************************************************************/
+/* touch: time init_heap, a first pass that allocates and    */
+/*        fills n objects of size s (taking the page faults) */
+/*        and iters steady-state passes over the same heap.  */
+/*        Use with --thp, --hugetlb and --populate.          */
+/*************************************************************/
+
+static void touch_pass(void **p, int n, int s, int key)
+{
+  int i;
+
+  for (i = 0; i < n; i++) {
+    p[i] = checked_malloc(s, 0);
+    fill(p[i], key, s);
+  }
+  for (i = n; i--; )
+    mm_free(p[i]);
+}
+
+void alloc_touch(int n, int s, int iters, int compact)
+{
+  long init_time, first_time, steady_time;
+  void *p[n];
+  int j;
+
+  init_time = now();
+  init_heap(n, s, n*s, compact);
+  init_time = now() - init_time;
+
+  first_time = now();
+  touch_pass(p, n, s, 0);
+  first_time = now() - first_time;
+
+  steady_time = now();
+  for (j = 0; j < iters; j++)
+    touch_pass(p, n, s, j);
+  steady_time = now() - steady_time;
+  steady_time++; /* make sure it's not 0 */
+
+  printf("init_heap %ld ms, first touch %ld ms, steady %.0f MB/s\n",
+         init_time, first_time,
+         ((double)n * s * iters / (1024 * 1024)) / (steady_time / 1000.0));
+}
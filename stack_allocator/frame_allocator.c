@@ -0,0 +1,40 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "frame_allocator.h"
+
+bool init_frame_allocator(struct frameAllocator *allocator, size_t length)
+{
+  allocator->current = 0;
+  allocator->frame = 0;
+
+  if (!init_allocator(&allocator->stacks[0], length)) {
+    return false;
+  }
+  if (!init_allocator(&allocator->stacks[1], length)) {
+    destroy_allocator(&allocator->stacks[0]);
+    return false;
+  }
+
+  return true;
+}
+
+void *frame_allocate(struct frameAllocator *allocator, size_t n)
+{
+  return allocate(&allocator->stacks[allocator->current], n);
+}
+
+void begin_frame(struct frameAllocator *allocator)
+{
+  /* the other stack holds frame N-1, which is no longer referenced */
+  allocator->current ^= 1;
+  allocator->frame++;
+  reset_allocator(&allocator->stacks[allocator->current]);
+}
+
+bool destroy_frame_allocator(struct frameAllocator *allocator)
+{
+  bool result = destroy_allocator(&allocator->stacks[0]);
+
+  return destroy_allocator(&allocator->stacks[1]) && result;
+}
@@ -0,0 +1,23 @@
+#ifndef FRAME_ALLOCATOR_H
+#define FRAME_ALLOCATOR_H
+
+#include <stdbool.h>
+#include "stack_allocator.h"
+
+/*
+ * Double-buffered frame allocator. Allocations made during frame N live in
+ * one stack and stay valid through frame N+1; when frame N+2 begins that
+ * stack is reset as a whole, so scratch data never needs deallocate().
+ */
+struct frameAllocator {
+  struct stackAllocator stacks[2];
+  int current;
+  unsigned long frame;
+};
+
+extern bool init_frame_allocator(struct frameAllocator *allocator, size_t length);
+extern void *frame_allocate(struct frameAllocator *allocator, size_t n);
+extern void begin_frame(struct frameAllocator *allocator);
+extern bool destroy_frame_allocator(struct frameAllocator *allocator);
+
+#endif
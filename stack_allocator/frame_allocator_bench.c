@@ -0,0 +1,98 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "frame_allocator.h"
+
+#define FRAMES 10000
+#define ALLOCS_PER_FRAME 256
+#define MAX_ALLOC 1024
+#define FRAME_LENGTH (ALLOCS_PER_FRAME * (MAX_ALLOC + sizeof(struct allocate_state)) + 4096)
+
+static double now_ms()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static size_t sizes[ALLOCS_PER_FRAME];
+
+static void pick_sizes(unsigned int *seed)
+{
+  int i;
+
+  for (i = 0; i < ALLOCS_PER_FRAME; i++) {
+    sizes[i] = 16 + rand_r(seed) % (MAX_ALLOC - 16);
+  }
+}
+
+static double run_frame_allocator()
+{
+  struct frameAllocator allocator;
+  unsigned int seed = 1;
+  double start;
+  int f, i;
+  char *p;
+
+  EXPECT(init_frame_allocator(&allocator, FRAME_LENGTH), true, "init frame allocator failed");
+
+  start = now_ms();
+  for (f = 0; f < FRAMES; f++) {
+    begin_frame(&allocator);
+    pick_sizes(&seed);
+    for (i = 0; i < ALLOCS_PER_FRAME; i++) {
+      p = frame_allocate(&allocator, sizes[i]);
+      EXPECT(p != NULL, true, "frame allocate failed");
+      memset(p, f, sizes[i]);
+    }
+  }
+  start = now_ms() - start;
+
+  destroy_frame_allocator(&allocator);
+  return start;
+}
+
+static double run_malloc()
+{
+  /* scratch data of frame N is kept alive through frame N+1, as above */
+  static char *live[2][ALLOCS_PER_FRAME];
+  unsigned int seed = 1;
+  int current = 0;
+  double start;
+  int f, i;
+
+  start = now_ms();
+  for (f = 0; f < FRAMES; f++) {
+    current ^= 1;
+    for (i = 0; i < ALLOCS_PER_FRAME; i++) {
+      free(live[current][i]);
+    }
+    pick_sizes(&seed);
+    for (i = 0; i < ALLOCS_PER_FRAME; i++) {
+      live[current][i] = malloc(sizes[i]);
+      EXPECT(live[current][i] != NULL, true, "malloc failed");
+      memset(live[current][i], f, sizes[i]);
+    }
+  }
+  for (current = 0; current < 2; current++) {
+    for (i = 0; i < ALLOCS_PER_FRAME; i++) {
+      free(live[current][i]);
+    }
+  }
+  return now_ms() - start;
+}
+
+int main()
+{
+  double frame_ms, malloc_ms;
+
+  frame_ms = run_frame_allocator();
+  malloc_ms = run_malloc();
+
+  printf("%d frames x %d allocations (16..%d bytes)\n", FRAMES, ALLOCS_PER_FRAME, MAX_ALLOC);
+  printf("frame allocator: %.2f ms\n", frame_ms);
+  printf("malloc/free:     %.2f ms\n", malloc_ms);
+
+  return 0;
+}
@@ -0,0 +1,35 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "frame_allocator.h"
+
+int main()
+{
+  struct game_resource *resource_a, *resource_b, *resource_c;
+  struct frameAllocator allocator;
+
+  EXPECT(init_frame_allocator(&allocator, 4096), true, "init frame allocator failed");
+
+  resource_a = frame_allocate(&allocator, sizeof(struct game_resource));
+  EXPECT(resource_a != NULL, true, "frame allocate failed");
+  resource_a->level = 1;
+  strcpy(resource_a->name, "frame0");
+
+  begin_frame(&allocator);
+  resource_b = frame_allocate(&allocator, sizeof(struct game_resource));
+  EXPECT(resource_b != NULL, true, "frame allocate failed");
+  resource_b->level = 2;
+  strcpy(resource_b->name, "frame1");
+
+  /* frame 0 data is still valid during frame 1 */
+  EXPECT(strcmp(resource_a->name, "frame0"), 0, "previous frame data overwritten");
+
+  begin_frame(&allocator);
+  resource_c = frame_allocate(&allocator, sizeof(struct game_resource));
+  EXPECT(resource_c == resource_a, true, "frame buffer was not reset");
+  printf("%s allocated\n", resource_b->name);
+
+  EXPECT(destroy_frame_allocator(&allocator), true, "destroy frame allocator failed");
+
+  return 0;
+}
@@ -0,0 +1,152 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "growable_allocator.h"
+
+static struct stackChunk *map_chunk(size_t length, int flags)
+{
+  struct stackChunk *chunk = malloc(sizeof(struct stackChunk));
+
+  if (chunk == NULL) {
+    return NULL;
+  }
+  if (!init_allocator_with_flags(&chunk->stack, length, flags)) {
+    free(chunk);
+    return NULL;
+  }
+  chunk->prev = NULL;
+
+  return chunk;
+}
+
+static void unmap_chunk(struct stackChunk *chunk)
+{
+  destroy_allocator(&chunk->stack);
+  free(chunk);
+}
+
+/* park an emptied chunk on the spare list, or unmap it past the limit */
+static void retire_chunk(struct growableAllocator *allocator, struct stackChunk *chunk)
+{
+  allocator->chunks--;
+
+  if (allocator->spare_chunks >= allocator->retain_chunks) {
+    unmap_chunk(chunk);
+    return;
+  }
+  reset_allocator(&chunk->stack);
+  chunk->prev = allocator->spare;
+  allocator->spare = chunk;
+  allocator->spare_chunks++;
+}
+
+static struct stackChunk *grow(struct growableAllocator *allocator, size_t n)
+{
+  size_t need = n + sizeof(struct allocate_state);
+  struct stackChunk *chunk = allocator->spare;
+
+  if (chunk != NULL && chunk->stack.length >= need) {
+    allocator->spare = chunk->prev;
+    allocator->spare_chunks--;
+  } else {
+    chunk = map_chunk(need > allocator->chunk_length ? need : allocator->chunk_length, allocator->flags);
+    if (chunk == NULL) {
+      return NULL;
+    }
+  }
+
+  chunk->prev = allocator->current;
+  allocator->current = chunk;
+  allocator->chunks++;
+
+  return chunk;
+}
+
+bool init_growable_allocator(struct growableAllocator *allocator, size_t chunk_length, int retain_chunks, int flags)
+{
+  allocator->chunk_length = chunk_length;
+  allocator->flags = flags;
+  allocator->retain_chunks = retain_chunks;
+  allocator->spare = NULL;
+  allocator->spare_chunks = 0;
+  allocator->chunks = 1;
+  pthread_mutex_init(&allocator->mu, NULL);
+
+  allocator->current = map_chunk(chunk_length, flags);
+
+  return allocator->current != NULL;
+}
+
+void *growable_allocate(struct growableAllocator *allocator, size_t n)
+{
+  struct stackChunk *chunk;
+  void *temp;
+
+  pthread_mutex_lock(&allocator->mu);
+
+  temp = allocate_unlocked(&allocator->current->stack, n);
+  if (temp == NULL) {
+    chunk = grow(allocator, n);
+    if (chunk == NULL) {
+      DEBUG("No more space for a new chunk");
+    } else {
+      temp = allocate_unlocked(&chunk->stack, n);
+    }
+  }
+
+  pthread_mutex_unlock(&allocator->mu);
+
+  return temp;
+}
+
+bool growable_deallocate(struct growableAllocator *allocator, void *addr)
+{
+  struct stackChunk *chunk;
+  bool result;
+
+  pthread_mutex_lock(&allocator->mu);
+
+  chunk = allocator->current;
+  result = deallocate_unlocked(&chunk->stack, addr);
+
+  /* the current chunk is never left empty unless it is the first one */
+  if (result && chunk->stack.head == NULL && chunk->prev != NULL) {
+    allocator->current = chunk->prev;
+    retire_chunk(allocator, chunk);
+  }
+
+  pthread_mutex_unlock(&allocator->mu);
+
+  return result;
+}
+
+void reset_growable_allocator(struct growableAllocator *allocator)
+{
+  struct stackChunk *chunk;
+
+  pthread_mutex_lock(&allocator->mu);
+
+  while (allocator->current->prev != NULL) {
+    chunk = allocator->current;
+    allocator->current = chunk->prev;
+    retire_chunk(allocator, chunk);
+  }
+  reset_allocator(&allocator->current->stack);
+
+  pthread_mutex_unlock(&allocator->mu);
+}
+
+void destroy_growable_allocator(struct growableAllocator *allocator)
+{
+  struct stackChunk *chunk;
+
+  while ((chunk = allocator->current) != NULL) {
+    allocator->current = chunk->prev;
+    unmap_chunk(chunk);
+  }
+  while ((chunk = allocator->spare) != NULL) {
+    allocator->spare = chunk->prev;
+    unmap_chunk(chunk);
+  }
+  pthread_mutex_destroy(&allocator->mu);
+}
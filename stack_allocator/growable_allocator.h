@@ -0,0 +1,37 @@
+#ifndef GROWABLE_ALLOCATOR_H
+#define GROWABLE_ALLOCATOR_H
+
+#include <stdbool.h>
+#include <pthread.h>
+#include "stack_allocator.h"
+
+/*
+ * Stack allocator that chains a new mmap'd chunk when the current one is
+ * full instead of failing. A chunk is released once deallocate() or a
+ * reset empties it; up to retain_chunks emptied chunks stay mapped for
+ * reuse so allocations bouncing across a chunk boundary don't thrash
+ * mmap/munmap. The first chunk is kept until the allocator is destroyed.
+ */
+struct stackChunk {
+  struct stackAllocator stack;
+  struct stackChunk *prev;
+};
+
+struct growableAllocator {
+  struct stackChunk *current;
+  struct stackChunk *spare;
+  size_t chunk_length;
+  int flags;
+  int chunks;
+  int spare_chunks;
+  int retain_chunks;
+  pthread_mutex_t mu;
+};
+
+extern bool init_growable_allocator(struct growableAllocator *allocator, size_t chunk_length, int retain_chunks, int flags);
+extern void *growable_allocate(struct growableAllocator *allocator, size_t n);
+extern bool growable_deallocate(struct growableAllocator *allocator, void *addr);
+extern void reset_growable_allocator(struct growableAllocator *allocator);
+extern void destroy_growable_allocator(struct growableAllocator *allocator);
+
+#endif
@@ -0,0 +1,49 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "growable_allocator.h"
+
+#define RESOURCES 256
+
+int main()
+{
+  struct game_resource *resources[RESOURCES];
+  struct growableAllocator allocator;
+  char *big;
+  int i;
+
+  EXPECT(init_growable_allocator(&allocator, 4096, 1, 0), true, "init growable allocator failed");
+
+  /* far more than one 4k chunk holds */
+  for (i = 0; i < RESOURCES; i++) {
+    resources[i] = growable_allocate(&allocator, sizeof(struct game_resource));
+    EXPECT(resources[i] != NULL, true, "growable allocate failed");
+    resources[i]->level = i;
+  }
+  EXPECT(allocator.chunks > 1, true, "allocator did not grow");
+
+  /* larger than a chunk gets a chunk of its own */
+  big = growable_allocate(&allocator, 3 * 4096);
+  EXPECT(big != NULL, true, "large growable allocate failed");
+  memset(big, 1, 3 * 4096);
+  EXPECT(growable_deallocate(&allocator, big), true, "large growable deallocate failed");
+
+  EXPECT(growable_deallocate(&allocator, resources[0]), false, "out of order deallocate succeeded");
+  for (i = RESOURCES; i--; ) {
+    EXPECT(resources[i]->level, i, "resource overwritten");
+    EXPECT(growable_deallocate(&allocator, resources[i]), true, "growable deallocate failed");
+  }
+  EXPECT(allocator.chunks, 1, "chunks not released");
+  EXPECT(allocator.spare_chunks, 1, "spare chunk not retained");
+  printf("%d resources in chained chunks\n", RESOURCES);
+
+  for (i = 0; i < RESOURCES; i++) {
+    EXPECT(growable_allocate(&allocator, sizeof(struct game_resource)) != NULL, true, "growable allocate failed");
+  }
+  reset_growable_allocator(&allocator);
+  EXPECT(allocator.chunks, 1, "reset did not release chunks");
+
+  destroy_growable_allocator(&allocator);
+
+  return 0;
+}
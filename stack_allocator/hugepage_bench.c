@@ -0,0 +1,123 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <stdbool.h>
+#include "stack_allocator.h"
+
+#define BLOCK_SIZE (64 * 1024)
+#define STEADY_PASSES 4
+
+static double now_ms()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+/* allocate the region in BLOCK_SIZE pieces and write every byte once */
+static size_t fill_pass(struct stackAllocator *allocator, int key)
+{
+  size_t filled = 0;
+  char *p;
+
+  reset_allocator(allocator);
+  while ((p = allocate(allocator, BLOCK_SIZE)) != NULL) {
+    memset(p, key, BLOCK_SIZE);
+    filled += BLOCK_SIZE;
+  }
+  return filled;
+}
+
+/* KB of the mapping at addr that /proc/self/smaps reports as huge pages */
+static long huge_kb(void *addr)
+{
+  char line[256];
+  unsigned long start, end;
+  bool found = false;
+  long kb, total = 0;
+  FILE *f = fopen("/proc/self/smaps", "r");
+
+  if (f == NULL) {
+    return 0;
+  }
+  while (fgets(line, sizeof(line), f) != NULL) {
+    if (sscanf(line, "%lx-%lx ", &start, &end) == 2 && strchr(line, ':') > strchr(line, ' ')) {
+      if (found) {
+        break;
+      }
+      found = start == (unsigned long)addr;
+    } else if (found
+               && (sscanf(line, "AnonHugePages: %ld kB", &kb) == 1
+                   || sscanf(line, "ShmemPmdMapped: %ld kB", &kb) == 1
+                   || sscanf(line, "FilePmdMapped: %ld kB", &kb) == 1
+                   || sscanf(line, "Shared_Hugetlb: %ld kB", &kb) == 1
+                   || sscanf(line, "Private_Hugetlb: %ld kB", &kb) == 1)) {
+      total += kb;
+    }
+  }
+  fclose(f);
+
+  return total;
+}
+
+static void run(const char *name, size_t length, int flags)
+{
+  struct stackAllocator allocator;
+  double init_ms, first_ms, steady_ms;
+  size_t filled = 0;
+  const char *status;
+  long huge;
+  int i;
+
+  init_ms = now_ms();
+  EXPECT(init_allocator_with_flags(&allocator, length, flags), true, "init allocator failed");
+  init_ms = now_ms() - init_ms;
+
+  first_ms = now_ms();
+  fill_pass(&allocator, 1);
+  first_ms = now_ms() - first_ms;
+
+  steady_ms = now_ms();
+  for (i = 0; i < STEADY_PASSES; i++) {
+    filled += fill_pass(&allocator, i);
+  }
+  steady_ms = now_ms() - steady_ms;
+
+  /* huge page modes only count as ok when the kernel really used them */
+  huge = huge_kb(allocator.base_addr);
+  if (!(flags & (ALLOCATOR_HUGEPAGE|ALLOCATOR_HUGETLB))) {
+    status = "ok";
+  } else if (huge == 0) {
+    status = (flags & ~allocator.flags) ? "fallback" : "4k only";
+  } else {
+    status = "ok";
+  }
+
+  printf("%-16s %-8s huge %8ld KB  init %8.2f ms  first touch %8.2f ms  steady %8.2f MB/s\n",
+         name, status, huge,
+         init_ms, first_ms,
+         (filled / (1024.0 * 1024.0)) / (steady_ms / 1000.0));
+
+  destroy_allocator(&allocator);
+}
+
+int main(int argc, char **argv)
+{
+  size_t length = 256;
+
+  if (argc > 1) {
+    length = atol(argv[1]);
+  }
+  printf("region %zu MB, %d KB blocks\n", length, BLOCK_SIZE / 1024);
+  length <<= 20;
+
+  run("4k pages", length, 0);
+  run("populate", length, ALLOCATOR_POPULATE);
+  run("thp", length, ALLOCATOR_HUGEPAGE);
+  run("thp+populate", length, ALLOCATOR_HUGEPAGE|ALLOCATOR_POPULATE);
+  run("hugetlb", length, ALLOCATOR_HUGETLB);
+  run("hugetlb+populate", length, ALLOCATOR_HUGETLB|ALLOCATOR_POPULATE);
+
+  return 0;
+}
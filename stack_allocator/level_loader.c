@@ -0,0 +1,205 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include "level_loader.h"
+
+static void push(struct resourceQueue *queue, struct resourceLoad *load)
+{
+  load->next = NULL;
+  if (queue->tail == NULL) {
+    queue->head = load;
+  } else {
+    queue->tail->next = load;
+  }
+  queue->tail = load;
+}
+
+static struct resourceLoad *pop(struct resourceQueue *queue)
+{
+  struct resourceLoad *load = queue->head;
+
+  if (load != NULL) {
+    queue->head = load->next;
+    if (queue->head == NULL) {
+      queue->tail = NULL;
+    }
+  }
+  return load;
+}
+
+static bool read_all(int fd, char *buf, size_t n, off_t offset)
+{
+  ssize_t got;
+
+  while (n > 0) {
+    got = pread(fd, buf, n, offset);
+    if (got <= 0) {
+      return false;
+    }
+    buf += got;
+    n -= got;
+    offset += got;
+  }
+  return true;
+}
+
+/* wait for the next queued load; NULL once the queue is drained and *stop is set */
+static struct resourceLoad *next_load(struct levelLoader *loader, struct resourceQueue *queue, bool *stop)
+{
+  struct resourceLoad *load;
+
+  pthread_mutex_lock(&loader->mu);
+  while ((load = pop(queue)) == NULL && !*stop) {
+    pthread_cond_wait(&loader->queued, &loader->mu);
+  }
+  pthread_mutex_unlock(&loader->mu);
+
+  return load;
+}
+
+static void finish(struct levelLoader *loader, struct resourceLoad *load, int state)
+{
+  pthread_mutex_lock(&loader->mu);
+  load->state = state;
+  if (state == RESOURCE_READ) {
+    push(&loader->decodes, load);
+    pthread_cond_broadcast(&loader->queued);
+  } else {
+    pthread_cond_broadcast(&loader->done);
+  }
+  pthread_mutex_unlock(&loader->mu);
+}
+
+static void *io_thread(void *arg)
+{
+  struct levelLoader *loader = arg;
+  struct resourceLoad *load, *ahead;
+  off_t offsets[READ_AHEAD_RESOURCES];
+  size_t lengths[READ_AHEAD_RESOURCES];
+  int i, n;
+
+  while ((load = next_load(loader, &loader->reads, &loader->closing)) != NULL) {
+    /* let the kernel start on the reads queued behind this one; only
+       collect them under the lock, WILLNEED can block on I/O */
+    n = 0;
+    pthread_mutex_lock(&loader->mu);
+    for (ahead = loader->reads.head, i = 0; ahead != NULL && i < READ_AHEAD_RESOURCES; ahead = ahead->next, i++) {
+      if (!ahead->advised) {
+        ahead->advised = true;
+        offsets[n] = ahead->offset;
+        lengths[n++] = ahead->length;
+      }
+    }
+    pthread_mutex_unlock(&loader->mu);
+
+    for (i = 0; i < n; i++) {
+      posix_fadvise(loader->fd, offsets[i], lengths[i], POSIX_FADV_WILLNEED);
+    }
+
+    if (read_all(loader->fd, load->addr, load->length, load->offset)) {
+      finish(loader, load, RESOURCE_READ);
+    } else {
+      DEBUG("reading resource at %ld failed", (long)load->offset);
+      finish(loader, load, RESOURCE_FAILED);
+    }
+  }
+
+  return NULL;
+}
+
+static void *decode_thread(void *arg)
+{
+  struct levelLoader *loader = arg;
+  struct resourceLoad *load;
+
+  while ((load = next_load(loader, &loader->decodes, &loader->reads_done)) != NULL) {
+    if (load->decode != NULL) {
+      load->decode(load->addr, load->length, load->arg);
+    }
+    finish(loader, load, RESOURCE_READY);
+  }
+
+  return NULL;
+}
+
+bool init_level_loader(struct levelLoader *loader, struct stackAllocator *allocator, const char *path)
+{
+  loader->allocator = allocator;
+  loader->closing = false;
+  loader->reads_done = false;
+  loader->reads.head = loader->reads.tail = NULL;
+  loader->decodes.head = loader->decodes.tail = NULL;
+
+  loader->fd = open(path, O_RDONLY);
+  if (loader->fd < 0) {
+    perror("init level loader");
+    return false;
+  }
+  posix_fadvise(loader->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+  pthread_mutex_init(&loader->mu, NULL);
+  pthread_cond_init(&loader->queued, NULL);
+  pthread_cond_init(&loader->done, NULL);
+  pthread_create(&loader->io_thread, NULL, io_thread, loader);
+  pthread_create(&loader->decode_thread, NULL, decode_thread, loader);
+
+  return true;
+}
+
+bool load_resource(struct levelLoader *loader, struct resourceLoad *load,
+                   off_t offset, size_t length, decode_fn decode, void *arg)
+{
+  load->addr = allocate(loader->allocator, length);
+  if (load->addr == NULL) {
+    return false;
+  }
+  load->offset = offset;
+  load->length = length;
+  load->decode = decode;
+  load->arg = arg;
+  load->state = RESOURCE_QUEUED;
+  load->advised = false;
+
+  pthread_mutex_lock(&loader->mu);
+  push(&loader->reads, load);
+  pthread_cond_broadcast(&loader->queued);
+  pthread_mutex_unlock(&loader->mu);
+
+  return true;
+}
+
+bool wait_resource(struct levelLoader *loader, struct resourceLoad *load)
+{
+  int state;
+
+  pthread_mutex_lock(&loader->mu);
+  while ((state = load->state) != RESOURCE_READY && state != RESOURCE_FAILED) {
+    pthread_cond_wait(&loader->done, &loader->mu);
+  }
+  pthread_mutex_unlock(&loader->mu);
+
+  return state == RESOURCE_READY;
+}
+
+/* finishes every load already queued, then stops both threads */
+void close_level_loader(struct levelLoader *loader)
+{
+  pthread_mutex_lock(&loader->mu);
+  loader->closing = true;
+  pthread_cond_broadcast(&loader->queued);
+  pthread_mutex_unlock(&loader->mu);
+  pthread_join(loader->io_thread, NULL);
+
+  pthread_mutex_lock(&loader->mu);
+  loader->reads_done = true;
+  pthread_cond_broadcast(&loader->queued);
+  pthread_mutex_unlock(&loader->mu);
+  pthread_join(loader->decode_thread, NULL);
+
+  close(loader->fd);
+  pthread_mutex_destroy(&loader->mu);
+  pthread_cond_destroy(&loader->queued);
+  pthread_cond_destroy(&loader->done);
+}
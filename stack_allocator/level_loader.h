@@ -0,0 +1,62 @@
+#ifndef LEVEL_LOADER_H
+#define LEVEL_LOADER_H
+
+#include <stdbool.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include "stack_allocator.h"
+
+/*
+ * Asynchronous level streaming. load_resource() reserves space with
+ * allocate() on the calling thread, so the usual LIFO rules apply, and
+ * queues the read. An I/O thread fills the space with pread() while
+ * issuing read-ahead for the reads queued behind it, and hands it to a
+ * decode thread, so reading the next resource overlaps decoding the
+ * previous one. Completion is signalled per resource; see wait_resource().
+ */
+#define RESOURCE_QUEUED 0
+#define RESOURCE_READ 1
+#define RESOURCE_READY 2
+#define RESOURCE_FAILED 3
+
+#define READ_AHEAD_RESOURCES 4
+
+typedef void (*decode_fn)(void *addr, size_t length, void *arg);
+
+struct resourceLoad {
+  off_t offset;
+  size_t length;
+  char *addr;
+  decode_fn decode;
+  void *arg;
+  int state;
+  bool advised;
+  struct resourceLoad *next;
+};
+
+struct resourceQueue {
+  struct resourceLoad *head;
+  struct resourceLoad *tail;
+};
+
+struct levelLoader {
+  struct stackAllocator *allocator;
+  int fd;
+  bool closing;
+  bool reads_done;
+  struct resourceQueue reads;
+  struct resourceQueue decodes;
+  pthread_mutex_t mu;
+  pthread_cond_t queued;
+  pthread_cond_t done;
+  pthread_t io_thread;
+  pthread_t decode_thread;
+};
+
+extern bool init_level_loader(struct levelLoader *loader, struct stackAllocator *allocator, const char *path);
+extern bool load_resource(struct levelLoader *loader, struct resourceLoad *load,
+                          off_t offset, size_t length, decode_fn decode, void *arg);
+extern bool wait_resource(struct levelLoader *loader, struct resourceLoad *load);
+extern void close_level_loader(struct levelLoader *loader);
+
+#endif
@@ -0,0 +1,137 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <time.h>
+#include "level_loader.h"
+
+#define RESOURCE_SIZE (1 << 20)
+#define DECODE_PASSES 4
+
+static double now_ms()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+/* stands in for decompression: a few checksum passes over the data */
+static void decode_resource(void *addr, size_t length, void *arg)
+{
+  uint64_t *words = addr, hash = 1469598103934665603ULL;
+  size_t i;
+  int pass;
+
+  for (pass = 0; pass < DECODE_PASSES; pass++) {
+    for (i = 0; i < length / sizeof(uint64_t); i++) {
+      hash = (hash ^ words[i]) * 1099511628211ULL;
+    }
+  }
+  *(uint64_t *)arg = hash;
+}
+
+static void generate(const char *path, int resources)
+{
+  char *buf = malloc(RESOURCE_SIZE);
+  unsigned int seed = 1;
+  int fd, i, j;
+
+  fd = open(path, O_WRONLY|O_CREAT|O_TRUNC, 0644);
+  EXPECT(fd >= 0, true, "create asset file failed");
+  for (i = 0; i < resources; i++) {
+    for (j = 0; j < RESOURCE_SIZE; j++) {
+      buf[j] = rand_r(&seed);
+    }
+    EXPECT(write(fd, buf, RESOURCE_SIZE), RESOURCE_SIZE, "write asset file failed");
+  }
+  fsync(fd);
+  close(fd);
+  free(buf);
+}
+
+/* evict the file from the page cache so both runs read from disk */
+static void drop_cache(const char *path)
+{
+  int fd = open(path, O_RDONLY);
+  posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+  close(fd);
+}
+
+static double run_sync(const char *path, struct stackAllocator *allocator, int resources, uint64_t *hashes)
+{
+  double start = now_ms();
+  char *addr;
+  int fd, i;
+
+  fd = open(path, O_RDONLY);
+  for (i = 0; i < resources; i++) {
+    addr = allocate(allocator, RESOURCE_SIZE);
+    EXPECT(pread(fd, addr, RESOURCE_SIZE, (off_t)i * RESOURCE_SIZE), RESOURCE_SIZE, "read failed");
+    decode_resource(addr, RESOURCE_SIZE, &hashes[i]);
+  }
+  close(fd);
+
+  return now_ms() - start;
+}
+
+static double run_async(const char *path, struct stackAllocator *allocator, int resources, uint64_t *hashes)
+{
+  struct resourceLoad *loads = malloc(resources * sizeof(struct resourceLoad));
+  struct levelLoader loader;
+  double start = now_ms();
+  int i;
+
+  EXPECT(init_level_loader(&loader, allocator, path), true, "init level loader failed");
+  for (i = 0; i < resources; i++) {
+    EXPECT(load_resource(&loader, &loads[i], (off_t)i * RESOURCE_SIZE, RESOURCE_SIZE, decode_resource, &hashes[i]),
+           true, "load resource failed");
+  }
+  for (i = 0; i < resources; i++) {
+    EXPECT(wait_resource(&loader, &loads[i]), true, "resource not loaded");
+  }
+  close_level_loader(&loader);
+  free(loads);
+
+  return now_ms() - start;
+}
+
+int main(int argc, char **argv)
+{
+  struct stackAllocator allocator;
+  char path[] = "/tmp/level_assets_XXXXXX";
+  uint64_t *sync_hashes, *async_hashes;
+  double sync_ms, async_ms;
+  int resources = 256;
+
+  if (argc > 1) {
+    resources = atoi(argv[1]);
+  }
+  sync_hashes = calloc(resources, sizeof(uint64_t));
+  async_hashes = calloc(resources, sizeof(uint64_t));
+
+  close(mkstemp(path));
+  generate(path, resources);
+
+  EXPECT(init_allocator_with_flags(&allocator, (size_t)resources * (RESOURCE_SIZE + 64) + 4096,
+                                   ALLOCATOR_POPULATE), true, "init allocator failed");
+
+  drop_cache(path);
+  sync_ms = run_sync(path, &allocator, resources, sync_hashes);
+  reset_allocator(&allocator);
+
+  drop_cache(path);
+  async_ms = run_async(path, &allocator, resources, async_hashes);
+
+  EXPECT(memcmp(sync_hashes, async_hashes, resources * sizeof(uint64_t)), 0, "async load differs");
+
+  printf("%d resources of %d KB (%d MB asset file)\n", resources, RESOURCE_SIZE >> 10, resources * (RESOURCE_SIZE >> 20));
+  printf("sync  allocate+read+decode: %8.2f ms\n", sync_ms);
+  printf("async level loader:         %8.2f ms\n", async_ms);
+
+  destroy_allocator(&allocator);
+  unlink(path);
+
+  return 0;
+}
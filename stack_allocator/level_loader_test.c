@@ -0,0 +1,62 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "level_loader.h"
+
+#define RESOURCES 8
+
+/* decoding turns the stored level number into a name */
+static void decode_resource(void *addr, size_t length, void *arg)
+{
+  struct game_resource *resource = addr;
+  sprintf(resource->name, "level%d", resource->level);
+}
+
+int main()
+{
+  struct resourceLoad loads[RESOURCES], missing;
+  struct game_resource resource, *loaded;
+  struct stackAllocator allocator;
+  struct levelLoader loader;
+  char path[] = "/tmp/level_loader_XXXXXX";
+  FILE *file;
+  int i;
+
+  file = fdopen(mkstemp(path), "w");
+  for (i = 0; i < RESOURCES; i++) {
+    memset(&resource, 0, sizeof(resource));
+    resource.level = i;
+    fwrite(&resource, sizeof(resource), 1, file);
+  }
+  fclose(file);
+
+  EXPECT(init_allocator(&allocator, 4096), true, "init allocator failed");
+  EXPECT(init_level_loader(&loader, &allocator, path), true, "init level loader failed");
+
+  for (i = 0; i < RESOURCES; i++) {
+    EXPECT(load_resource(&loader, &loads[i], i * sizeof(resource), sizeof(resource), decode_resource, NULL),
+           true, "load resource failed");
+  }
+  /* past the end of the file */
+  EXPECT(load_resource(&loader, &missing, RESOURCES * sizeof(resource), sizeof(resource), NULL, NULL),
+         true, "load resource failed");
+
+  for (i = 0; i < RESOURCES; i++) {
+    EXPECT(wait_resource(&loader, &loads[i]), true, "resource not loaded");
+    loaded = (struct game_resource *)loads[i].addr;
+    EXPECT(loaded->level, i, "resource read incorrectly");
+  }
+  EXPECT(wait_resource(&loader, &missing), false, "short read succeeded");
+  printf("%s loaded\n", loaded->name);
+
+  close_level_loader(&loader);
+
+  EXPECT(deallocate(&allocator, missing.addr), true, "deallocate failed");
+  for (i = RESOURCES; i--; ) {
+    EXPECT(deallocate(&allocator, loads[i].addr), true, "deallocate failed");
+  }
+  unlink(path);
+
+  return 0;
+}
@@ -0,0 +1,132 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "pool_allocator.h"
+
+#define BITS 64
+
+/* round up so a slot never straddles a cache line */
+static size_t slot_size_for(size_t n)
+{
+  if (n <= 16) {
+    return 16;
+  } else if (n <= 32) {
+    return 32;
+  }
+  return (n + CACHE_LINE_SIZE - 1) & ~(size_t)(CACHE_LINE_SIZE - 1);
+}
+
+/* set the low `bits` bits of `count` words, the rest cleared */
+static void fill_bits(uint64_t *words, size_t count, size_t bits)
+{
+  memset(words, 0, count * sizeof(uint64_t));
+  memset(words, 0xff, bits / BITS * sizeof(uint64_t));
+  if (bits % BITS) {
+    words[bits / BITS] = (1ULL << (bits % BITS)) - 1;
+  }
+}
+
+bool init_pool_allocator(struct poolAllocator *pool, struct stackAllocator *allocator, size_t slot_size, size_t count)
+{
+  size_t bitmap_size;
+  char *addr;
+
+  pool->slot_size = slot_size_for(slot_size);
+  pool->count = count;
+  pool->words = (count + BITS - 1) / BITS;
+  pool->summary_words = (pool->words + BITS - 1) / BITS;
+  pool->top_words = (pool->summary_words + BITS - 1) / BITS;
+
+  bitmap_size = (pool->words + pool->summary_words + pool->top_words) * sizeof(uint64_t);
+  addr = allocate(allocator, sizeof(uint64_t) - 1 + bitmap_size + CACHE_LINE_SIZE + pool->slot_size * count);
+  if (addr == NULL) {
+    return false;
+  }
+  pool->region = addr;
+
+  /* allocate() makes no alignment promise */
+  addr = (char *)(((uintptr_t)addr + sizeof(uint64_t) - 1) & ~(uintptr_t)(sizeof(uint64_t) - 1));
+  pool->free_bits = (uint64_t *)addr;
+  pool->free_words = pool->free_bits + pool->words;
+  pool->free_summaries = pool->free_words + pool->summary_words;
+  addr += bitmap_size;
+  pool->slots = (char *)(((uintptr_t)addr + CACHE_LINE_SIZE - 1) & ~(uintptr_t)(CACHE_LINE_SIZE - 1));
+
+  clear_pool(pool);
+
+  return true;
+}
+
+void *pool_allocate(struct poolAllocator *pool)
+{
+  size_t top, summary, word, bit;
+
+  for (top = 0; top < pool->top_words; top++) {
+    if (pool->free_summaries[top] != 0) {
+      break;
+    }
+  }
+  if (top == pool->top_words) {
+    DEBUG("No more slots in pool");
+    return NULL;
+  }
+
+  summary = top * BITS + __builtin_ctzll(pool->free_summaries[top]);
+  word = summary * BITS + __builtin_ctzll(pool->free_words[summary]);
+  bit = __builtin_ctzll(pool->free_bits[word]);
+
+  pool->free_bits[word] &= ~(1ULL << bit);
+  if (pool->free_bits[word] == 0) {
+    pool->free_words[summary] &= ~(1ULL << (word % BITS));
+    if (pool->free_words[summary] == 0) {
+      pool->free_summaries[top] &= ~(1ULL << (summary % BITS));
+    }
+  }
+  pool->used++;
+
+  return pool->slots + (word * BITS + bit) * pool->slot_size;
+}
+
+bool pool_deallocate(struct poolAllocator *pool, void *addr)
+{
+  size_t offset = (char *)addr - pool->slots;
+  size_t index = offset / pool->slot_size;
+  size_t word = index / BITS;
+  size_t summary = word / BITS;
+  uint64_t mask = 1ULL << (index % BITS);
+
+  if ((char *)addr < pool->slots || index >= pool->count || offset % pool->slot_size != 0) {
+    DEBUG("address %p is not a slot of this pool", addr);
+    return false;
+  }
+  if (pool->free_bits[word] & mask) {
+    DEBUG("slot %p is already free", addr);
+    return false;
+  }
+
+  pool->free_bits[word] |= mask;
+  pool->free_words[summary] |= 1ULL << (word % BITS);
+  pool->free_summaries[summary / BITS] |= 1ULL << (summary % BITS);
+  pool->used--;
+
+  return true;
+}
+
+void clear_pool(struct poolAllocator *pool)
+{
+  fill_bits(pool->free_bits, pool->words, pool->count);
+  fill_bits(pool->free_words, pool->summary_words, pool->words);
+  fill_bits(pool->free_summaries, pool->top_words, pool->summary_words);
+  pool->used = 0;
+}
+
+bool release_pool_allocator(struct poolAllocator *pool, struct stackAllocator *allocator)
+{
+  if (!deallocate(allocator, pool->region)) {
+    return false;
+  }
+  /* an empty pool: pool_allocate() finds no top word and fails */
+  memset(pool, 0, sizeof(*pool));
+  return true;
+}
@@ -0,0 +1,43 @@
+#ifndef POOL_ALLOCATOR_H
+#define POOL_ALLOCATOR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "stack_allocator.h"
+
+#define CACHE_LINE_SIZE 64
+
+/*
+ * Fixed-size object pool carved out of a stack allocator, for records like
+ * game_resource that don't die in LIFO order. Free slots are tracked by a
+ * bitmap (1 = free), a summary bit per bitmap word and a top bit per
+ * summary word, all scanned with count-trailing-zeros. Allocation and
+ * free touch one word per level, so they are O(1) for up to 64^3 =
+ * 262144 slots; beyond that allocation scans one more top word per
+ * 262144 slots.
+ * Slots are sized so none straddles a cache line. The pool itself is not
+ * locked; give each thread its own pool.
+ * The pool is one allocation of the stack allocator it was carved from;
+ * hand it back in LIFO order with release_pool_allocator().
+ */
+struct poolAllocator {
+  char *region;
+  char *slots;
+  size_t slot_size;
+  size_t count;
+  size_t used;
+  uint64_t *free_bits;
+  uint64_t *free_words;
+  uint64_t *free_summaries;
+  size_t words;
+  size_t summary_words;
+  size_t top_words;
+};
+
+extern bool init_pool_allocator(struct poolAllocator *pool, struct stackAllocator *allocator, size_t slot_size, size_t count);
+extern void *pool_allocate(struct poolAllocator *pool);
+extern bool pool_deallocate(struct poolAllocator *pool, void *addr);
+extern void clear_pool(struct poolAllocator *pool);
+extern bool release_pool_allocator(struct poolAllocator *pool, struct stackAllocator *allocator);
+
+#endif
@@ -0,0 +1,91 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "pool_allocator.h"
+
+#define SLOTS 100000
+#define ROUNDS 100
+
+static double now_ms()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static struct game_resource *live[SLOTS];
+static int order[SLOTS];
+
+/* free a random half of the objects each round, then replace them */
+static double run(struct poolAllocator *pool)
+{
+  double start = now_ms();
+  int r, i, k;
+
+  for (i = 0; i < SLOTS; i++) {
+    live[i] = pool ? pool_allocate(pool) : malloc(sizeof(struct game_resource));
+    live[i]->level = i;
+  }
+  for (r = 0; r < ROUNDS; r++) {
+    for (i = 0; i < SLOTS / 2; i++) {
+      k = order[(i + r * 7919) % SLOTS];
+      if (pool) {
+        pool_deallocate(pool, live[k]);
+      } else {
+        free(live[k]);
+      }
+      live[k] = NULL;
+    }
+    for (i = 0; i < SLOTS; i++) {
+      if (live[i] == NULL) {
+        live[i] = pool ? pool_allocate(pool) : malloc(sizeof(struct game_resource));
+        live[i]->level = i;
+      }
+    }
+  }
+  if (pool) {
+    clear_pool(pool);
+  } else {
+    for (i = 0; i < SLOTS; i++) {
+      free(live[i]);
+    }
+  }
+  return now_ms() - start;
+}
+
+int main()
+{
+  struct stackAllocator allocator;
+  struct poolAllocator pool;
+  unsigned int seed = 1;
+  double pool_ms, malloc_ms;
+  long ops = (long)SLOTS + (long)ROUNDS * SLOTS;
+  int i, j, t;
+
+  /* random permutation, so frees happen far from LIFO order */
+  for (i = 0; i < SLOTS; i++) {
+    order[i] = i;
+  }
+  for (i = SLOTS - 1; i > 0; i--) {
+    j = rand_r(&seed) % (i + 1);
+    t = order[i];
+    order[i] = order[j];
+    order[j] = t;
+  }
+
+  EXPECT(init_allocator(&allocator, (size_t)SLOTS * 128), true, "init allocator failed");
+  EXPECT(init_pool_allocator(&pool, &allocator, sizeof(struct game_resource), SLOTS), true, "init pool failed");
+
+  pool_ms = run(&pool);
+  malloc_ms = run(NULL);
+
+  printf("%d live game_resource objects, %d rounds of random half replacement\n", SLOTS, ROUNDS);
+  printf("pool:        %8.2f ms  %6.1f Mops/s\n", pool_ms, ops / pool_ms / 1000.0);
+  printf("malloc/free: %8.2f ms  %6.1f Mops/s\n", malloc_ms, ops / malloc_ms / 1000.0);
+
+  EXPECT(release_pool_allocator(&pool, &allocator), true, "release pool failed");
+  EXPECT(destroy_allocator(&allocator), true, "destroy allocator failed");
+
+  return 0;
+}
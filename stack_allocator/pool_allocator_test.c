@@ -0,0 +1,65 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pool_allocator.h"
+
+#define RESOURCES 1000
+
+int main()
+{
+  struct game_resource *resources[RESOURCES];
+  struct stackAllocator allocator;
+  struct poolAllocator pool;
+  char *first;
+  char *top;
+  int i;
+
+  EXPECT(init_allocator(&allocator, 1 << 20), true, "init allocator failed");
+  /* an odd-sized allocation first leaves the pool's memory unaligned */
+  first = allocate(&allocator, 3);
+  EXPECT(first != NULL, true, "allocate failed");
+  top = allocator.top_addr;
+  EXPECT(init_pool_allocator(&pool, &allocator, sizeof(struct game_resource), RESOURCES), true, "init pool failed");
+  EXPECT((uintptr_t)pool.free_bits % sizeof(uint64_t), 0, "pool bitmap unaligned");
+  EXPECT(pool.slot_size % 16, 0, "slot size not aligned");
+
+  for (i = 0; i < RESOURCES; i++) {
+    resources[i] = pool_allocate(&pool);
+    EXPECT(resources[i] != NULL, true, "pool allocate failed");
+    EXPECT((uintptr_t)resources[i] / CACHE_LINE_SIZE,
+           ((uintptr_t)resources[i] + sizeof(struct game_resource) - 1) / CACHE_LINE_SIZE,
+           "slot straddles a cache line");
+    resources[i]->level = i;
+  }
+  EXPECT(pool_allocate(&pool) == NULL, true, "full pool allocate succeeded");
+
+  /* free in any order, then the freed slots come back */
+  for (i = 0; i < RESOURCES; i += 3) {
+    EXPECT(pool_deallocate(&pool, resources[i]), true, "pool deallocate failed");
+  }
+  EXPECT(pool_deallocate(&pool, resources[0]), false, "double free succeeded");
+  for (i = 0; i < RESOURCES; i += 3) {
+    resources[i] = pool_allocate(&pool);
+    EXPECT(resources[i] != NULL, true, "pool reallocate failed");
+    resources[i]->level = i;
+  }
+  for (i = 0; i < RESOURCES; i++) {
+    EXPECT(resources[i]->level, i, "resource overwritten");
+  }
+
+  clear_pool(&pool);
+  EXPECT(pool.used, 0, "pool not cleared");
+  EXPECT(pool_allocate(&pool), (void *)pool.slots, "cleared pool does not start over");
+  printf("%d resources pooled\n", RESOURCES);
+
+  /* the pool goes back to the stack allocator, and only in LIFO order */
+  EXPECT(deallocate(&allocator, first), false, "allocation under the pool freed");
+  EXPECT(release_pool_allocator(&pool, &allocator), true, "release pool failed");
+  EXPECT(allocator.top_addr, top, "pool memory not returned");
+  EXPECT(pool_allocate(&pool) == NULL, true, "released pool allocate succeeded");
+  EXPECT(release_pool_allocator(&pool, &allocator), false, "pool released twice");
+  EXPECT(deallocate(&allocator, first), true, "deallocate failed");
+  EXPECT(destroy_allocator(&allocator), true, "destroy allocator failed");
+
+  return 0;
+}
@@ -0,0 +1,151 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include "shared_allocator.h"
+
+#define CONTROL_SIZE ((sizeof(struct sharedStackAllocator) + 15) & ~15)
+
+struct sharedStackAllocator *init_shared_allocator(size_t length, int flags)
+{
+  struct stackAllocator region;
+  struct sharedStackAllocator *allocator;
+  pthread_mutexattr_t attr;
+
+  /* borrow the mapping (and its options) from a plain stack allocator */
+  if (!init_allocator_with_flags(&region, length, flags)) {
+    return NULL;
+  }
+  pthread_mutex_destroy(&region.mu);
+
+  allocator = (struct sharedStackAllocator *)region.base_addr;
+  allocator->length = region.length;
+  allocator->top = CONTROL_SIZE;
+  allocator->bottom = region.length;
+  allocator->head = 0;
+
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+  pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+  pthread_mutex_init(&allocator->mu, &attr);
+  pthread_mutexattr_destroy(&attr);
+
+  return allocator;
+}
+
+/*
+ * Stores below are ordered so that a process killed inside a critical
+ * section leaks at most one allocate_state slot (plus, in
+ * shared_allocate, the block it was carving):
+ *   shared_allocate writes the new state below bottom first, then
+ *   publishes bottom, top and head in that order;
+ *   shared_deallocate pops head first, then recomputes top and bottom
+ *   from the state chain instead of adjusting them.
+ * Recomputing means a later deallocate below a leaked block gives its
+ * bytes back, and emptying the arena gives the leaked slot back.
+ */
+#define ORDERED() __atomic_signal_fence(__ATOMIC_SEQ_CST)
+
+static bool lock(struct sharedStackAllocator *allocator)
+{
+  int err = pthread_mutex_lock(&allocator->mu);
+
+  if (err == EOWNERDEAD) {
+    DEBUG("previous owner died, recovering lock");
+    if (pthread_mutex_consistent(&allocator->mu) != 0) {
+      pthread_mutex_unlock(&allocator->mu);
+      return false;
+    }
+  } else if (err != 0) {
+    /* ENOTRECOVERABLE and friends: we do not own the mutex */
+    DEBUG("lock failed: %d", err);
+    return false;
+  }
+  return true;
+}
+
+void *shared_allocate(struct sharedStackAllocator *allocator, size_t n)
+{
+  size_t size = sizeof(struct allocate_state);
+  char *base = (char *)allocator;
+  char *temp = NULL;
+  size_t bottom;
+
+  if (!lock(allocator)) {
+    return NULL;
+  }
+
+  if (allocator->top + n + size > allocator->bottom) {
+    DEBUG("No more space for allocation");
+    goto unlock;
+  }
+  temp = base + allocator->top;
+  bottom = allocator->bottom - size;
+
+  struct allocate_state* state = (struct allocate_state *)(base + bottom);
+  state->next = allocator->head;
+  state->offset = allocator->top;
+  state->n = n;
+
+  ORDERED();
+  allocator->bottom = bottom;
+  ORDERED();
+  allocator->top += n;
+  ORDERED();
+  allocator->head = bottom;
+
+unlock:
+  pthread_mutex_unlock(&allocator->mu);
+
+  return temp;
+}
+
+bool shared_deallocate(struct sharedStackAllocator *allocator, void *addr)
+{
+  char *base = (char *)allocator;
+  bool result = false;
+
+  if (!lock(allocator)) {
+    return false;
+  }
+
+  if (allocator->head == 0) {
+    DEBUG("allocate state is null");
+    goto unlock;
+  }
+
+  struct allocate_state* state = (struct allocate_state *)(base + allocator->head);
+  if (base + state->offset != addr) {
+    DEBUG("addrsss mismatched: target %p state %p", addr, base + state->offset);
+    goto unlock;
+  }
+
+  /* the newest remaining state sits at bottom, the arena ends at length */
+  allocator->head = state->next;
+  ORDERED();
+  allocator->top = state->offset;
+  ORDERED();
+  allocator->bottom = state->next ? state->next : allocator->length;
+  result = true;
+
+unlock:
+  pthread_mutex_unlock(&allocator->mu);
+
+  return result;
+}
+
+size_t shared_offset(struct sharedStackAllocator *allocator, void *addr)
+{
+  return (char *)addr - (char *)allocator;
+}
+
+void *shared_pointer(struct sharedStackAllocator *allocator, size_t offset)
+{
+  return (char *)allocator + offset;
+}
+
+bool destroy_shared_allocator(struct sharedStackAllocator *allocator)
+{
+  return munmap(allocator, allocator->length) == 0;
+}
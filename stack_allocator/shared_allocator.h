@@ -0,0 +1,32 @@
+#ifndef SHARED_ALLOCATOR_H
+#define SHARED_ALLOCATOR_H
+
+#include <stdbool.h>
+#include <pthread.h>
+#include "stack_allocator.h"
+
+/*
+ * Stack allocator whose control block lives at the start of its own
+ * MAP_SHARED mapping, so processes forked after init_shared_allocator()
+ * all share one arena. Every link is an offset from the control block and
+ * the mutex is process-shared and robust: a process that dies holding it
+ * does not wedge the others, and leaks at most one allocate_state slot
+ * (see shared_allocator.c). Once the mutex is not recoverable,
+ * shared_allocate() returns NULL and shared_deallocate() false.
+ */
+struct sharedStackAllocator {
+  size_t length;
+  size_t top;
+  size_t bottom;
+  size_t head;
+  pthread_mutex_t mu;
+};
+
+extern struct sharedStackAllocator *init_shared_allocator(size_t length, int flags);
+extern void *shared_allocate(struct sharedStackAllocator *allocator, size_t n);
+extern bool shared_deallocate(struct sharedStackAllocator *allocator, void *addr);
+extern size_t shared_offset(struct sharedStackAllocator *allocator, void *addr);
+extern void *shared_pointer(struct sharedStackAllocator *allocator, size_t offset);
+extern bool destroy_shared_allocator(struct sharedStackAllocator *allocator);
+
+#endif
@@ -0,0 +1,80 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/wait.h>
+#include "shared_allocator.h"
+
+#define WORKERS 4
+#define ROUNDS 20000
+
+int main()
+{
+  struct sharedStackAllocator *allocator;
+  struct game_resource *resource;
+  size_t *table;
+  pid_t pid, pids[WORKERS];
+  int i, round, status;
+
+  allocator = init_shared_allocator(65536, 0);
+  EXPECT(allocator != NULL, true, "init shared allocator failed");
+
+  table = shared_allocate(allocator, WORKERS * sizeof(size_t));
+  EXPECT(table != NULL, true, "shared allocate failed");
+  memset(table, 0, WORKERS * sizeof(size_t));
+
+  /*
+   * All workers run at once, loading and unloading resources against the
+   * shared arena. A deallocate fails while another worker's block is on
+   * top, so a worker retries until its block is on top again.
+   */
+  for (i = 0; i < WORKERS; i++) {
+    pids[i] = fork();
+    if (pids[i] == 0) {
+      for (round = 0; round < ROUNDS; round++) {
+        resource = shared_allocate(allocator, sizeof(struct game_resource));
+        EXPECT(resource != NULL, true, "shared allocate in worker failed");
+        resource->level = i;
+        sprintf(resource->name, "worker%d", i);
+        sched_yield();
+        EXPECT(resource->level, i, "worker resource overwritten");
+        while (!shared_deallocate(allocator, resource)) {
+          sched_yield();
+        }
+        table[i]++;
+      }
+      _exit(0);
+    }
+  }
+  for (i = 0; i < WORKERS; i++) {
+    waitpid(pids[i], &status, 0);
+    EXPECT(WIFEXITED(status) && WEXITSTATUS(status) == 0, true, "worker failed");
+    EXPECT(table[i], ROUNDS, "worker rounds lost");
+  }
+  /* only the table is left */
+  EXPECT(allocator->bottom + sizeof(struct allocate_state), allocator->length, "workers left blocks behind");
+
+  /* a worker dying with the lock held must not wedge the arena */
+  pid = fork();
+  if (pid == 0) {
+    resource = shared_allocate(allocator, sizeof(struct game_resource));
+    EXPECT(resource != NULL, true, "shared allocate in worker failed");
+    resource->level = WORKERS;
+    sprintf(resource->name, "worker%d", WORKERS);
+    table[0] = shared_offset(allocator, resource);
+    pthread_mutex_lock(&allocator->mu);
+    _exit(0);
+  }
+  waitpid(pid, &status, 0);
+
+  resource = shared_pointer(allocator, table[0]);
+  EXPECT(resource->level, WORKERS, "worker resource not visible");
+  printf("%s shared\n", resource->name);
+  EXPECT(shared_deallocate(allocator, resource), true, "shared deallocate failed");
+  EXPECT(shared_deallocate(allocator, table), true, "shared deallocate failed");
+  EXPECT(allocator->head == 0 && allocator->bottom == allocator->length, true, "arena not empty");
+  EXPECT(destroy_shared_allocator(allocator), true, "destroy shared allocator failed");
+
+  return 0;
+}
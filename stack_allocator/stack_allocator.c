@@ -3,46 +3,125 @@
 #include <sys/mman.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include "stack_allocator.h"
 
+/*
+ * The region is a shared (shmem) mapping, where MADV_HUGEPAGE succeeds but
+ * does nothing unless shmem THP is "always", "within_size", "advise" or
+ * "force".
+ */
+static bool shmem_thp_enabled()
+{
+  char mode[128];
+  bool enabled = false;
+  FILE *f = fopen("/sys/kernel/mm/transparent_hugepage/shmem_enabled", "r");
+
+  if (f == NULL) {
+    return false;
+  }
+  if (fgets(mode, sizeof(mode), f) != NULL) {
+    enabled = strstr(mode, "[always]") || strstr(mode, "[within_size]")
+      || strstr(mode, "[advise]") || strstr(mode, "[force]");
+  }
+  fclose(f);
+
+  return enabled;
+}
+
+static char *map_region(size_t *length, int *flags)
+{
+  char *addr = MAP_FAILED;
+  int mmap_flags = MAP_SHARED|MAP_ANONYMOUS;
+
+  if (*flags & ALLOCATOR_POPULATE) {
+    mmap_flags |= MAP_POPULATE;
+  }
+
+  if (*flags & ALLOCATOR_HUGETLB) {
+    size_t huge_length = (*length + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+    addr = (char *)mmap(NULL, huge_length, PROT_READ|PROT_WRITE, mmap_flags|MAP_HUGETLB, -1, 0);
+    if (addr != MAP_FAILED) {
+      *length = huge_length;
+    } else {
+      DEBUG("MAP_HUGETLB failed, falling back to normal pages");
+      *flags &= ~ALLOCATOR_HUGETLB;
+    }
+  }
+
+  if (addr == MAP_FAILED) {
+    addr = (char *)mmap(NULL, *length, PROT_READ|PROT_WRITE, mmap_flags, -1, 0);
+    if (addr == MAP_FAILED) {
+      return NULL;
+    }
+  }
+
+  if (*flags & ALLOCATOR_HUGEPAGE) {
+    if (!shmem_thp_enabled()) {
+      DEBUG("shmem THP is disabled, MADV_HUGEPAGE would have no effect");
+      *flags &= ~ALLOCATOR_HUGEPAGE;
+    } else if (madvise(addr, *length, MADV_HUGEPAGE) != 0) {
+      DEBUG("MADV_HUGEPAGE failed");
+      *flags &= ~ALLOCATOR_HUGEPAGE;
+    }
+  }
+
+  return addr;
+}
+
 bool init_allocator(struct stackAllocator *allocator, size_t length)
+{
+  return init_allocator_with_flags(allocator, length, 0);
+}
+
+bool init_allocator_with_flags(struct stackAllocator *allocator, size_t length, int flags)
 {
   char *addr;
-  allocator->length = length;
   allocator->head = NULL;
   pthread_mutex_init(&allocator->mu, NULL);
 
-  addr = (char *)mmap(NULL, allocator->length, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_ANONYMOUS, -1, 0);
+  addr = map_region(&length, &flags);
   
-  if (addr == MAP_FAILED) {
+  if (addr == NULL) {
     perror("init allocator");
     return false;
   }
 
+  allocator->length = length;
+  allocator->flags = flags;
+  allocator->base_addr = addr;
   allocator->top_addr = addr;
   allocator->bottom_addr = allocator->top_addr + allocator->length;
   
   return true;
 }
 
-void *allocate(struct stackAllocator *allocator, size_t n)
+bool destroy_allocator(struct stackAllocator *allocator)
+{
+  pthread_mutex_destroy(&allocator->mu);
+
+  return munmap(allocator->base_addr, allocator->length) == 0;
+}
+
+void *allocate_unlocked(struct stackAllocator *allocator, size_t n)
 {
-  pthread_mutex_lock(&allocator->mu);
   char *temp = allocator->top_addr;
-  
-  if (temp + n >= allocator->bottom_addr) {
+  size_t size = sizeof(struct allocate_state);
+
+  if (allocator->flags & ALLOCATOR_READONLY) {
+    DEBUG("allocator is read only");
+    return NULL;
+  }
+  if (temp + n + size > allocator->bottom_addr) {
     DEBUG("No more space for allocation");
-    temp = NULL;
-    goto unlock;
+    return NULL;
   }
   allocator->top_addr += n;
-
-  size_t size = sizeof(struct allocate_state);
   allocator->bottom_addr -= size;
 
   struct allocate_state* state = (struct allocate_state *) allocator->bottom_addr;
-  state->next = NULL;
-  state->addr = temp;
+  state->next = 0;
+  state->offset = temp - allocator->base_addr;
   state->n = n;
 
   if (allocator->head == NULL)
@@ -50,39 +129,126 @@ void *allocate(struct stackAllocator *allocator, size_t n)
     allocator->head = state;
   }
   else {
-    state->next = allocator->head;
+    state->next = (char *)allocator->head - allocator->base_addr;
     allocator->head = state;
   }
 
-unlock:
-  pthread_mutex_unlock(&allocator->mu);
-
   return temp;
 }
 
-bool deallocate(struct stackAllocator *allocator, void *addr)
+bool deallocate_unlocked(struct stackAllocator *allocator, void *addr)
 {
-  bool result = false;
-  pthread_mutex_lock(&allocator->mu);
-
+  if (allocator->flags & ALLOCATOR_READONLY) {
+    DEBUG("allocator is read only");
+    return false;
+  }
   if (allocator->head == NULL) {
     DEBUG("allocate state is null");
-    goto unlock;
+    return false;
   }
-  if (allocator->head->addr != addr) {
-    DEBUG("addrsss mismatched: target %p state %p", addr, allocator->head->addr);
-    goto unlock;
+  if (allocator->base_addr + allocator->head->offset != addr) {
+    DEBUG("addrsss mismatched: target %p state %p", addr, allocator->base_addr + allocator->head->offset);
+    return false;
   }
 
   allocator->top_addr -= allocator->head->n;
   size_t size = sizeof(struct allocate_state);
   allocator->bottom_addr += size;
   
-  allocator->head = allocator->head->next;
-  result = true;
+  if (allocator->head->next == 0) {
+    allocator->head = NULL;
+  } else {
+    allocator->head = (struct allocate_state *)(allocator->base_addr + allocator->head->next);
+  }
+
+  return true;
+}
+
+void *allocate(struct stackAllocator *allocator, size_t n)
+{
+  pthread_mutex_lock(&allocator->mu);
+  void *temp = allocate_unlocked(allocator, n);
+  pthread_mutex_unlock(&allocator->mu);
+
+  return temp;
+}
+
+bool deallocate(struct stackAllocator *allocator, void *addr)
+{
+  pthread_mutex_lock(&allocator->mu);
+  bool result = deallocate_unlocked(allocator, addr);
+  pthread_mutex_unlock(&allocator->mu);
+
+  return result;
+}
+
+bool reset_allocator(struct stackAllocator *allocator)
+{
+  if (allocator->flags & ALLOCATOR_READONLY) {
+    DEBUG("allocator is read only");
+    return false;
+  }
+
+  pthread_mutex_lock(&allocator->mu);
+
+  allocator->top_addr = allocator->base_addr;
+  allocator->bottom_addr = allocator->base_addr + allocator->length;
+  allocator->head = NULL;
 
-unlock:
   pthread_mutex_unlock(&allocator->mu);
 
+  return true;
+}
+
+bool init_sub_allocator(struct stackAllocator *sub, struct stackAllocator *parent, size_t length)
+{
+  size_t align = SUB_ALLOCATOR_ALIGNMENT;
+  char *addr;
+
+  /* keep the slice base and its allocate states aligned */
+  length = (length + align - 1) & ~(align - 1);
+
+  /* the parent lock is only taken here, to carve out the slice */
+  addr = allocate(parent, length + align - 1);
+
+  if (addr == NULL) {
+    DEBUG("No more space for sub allocator");
+    return false;
+  }
+  addr = (char *)(((uintptr_t)addr + align - 1) & ~(uintptr_t)(align - 1));
+
+  sub->length = length;
+  sub->flags = parent->flags;
+  sub->head = NULL;
+  pthread_mutex_init(&sub->mu, NULL);
+  sub->base_addr = addr;
+  sub->top_addr = addr;
+  sub->bottom_addr = addr + length;
+
+  return true;
+}
+
+bool release_sub_allocator(struct stackAllocator *sub, struct stackAllocator *parent)
+{
+  struct allocate_state *head;
+  char *slice;
+  bool result = false;
+
+  pthread_mutex_lock(&parent->mu);
+
+  /* the slice starts up to SUB_ALLOCATOR_ALIGNMENT-1 bytes before the base */
+  head = parent->head;
+  if (head != NULL) {
+    slice = parent->base_addr + head->offset;
+    if (slice <= sub->base_addr && sub->base_addr < slice + head->n) {
+      result = deallocate_unlocked(parent, slice);
+    }
+  }
+
+  pthread_mutex_unlock(&parent->mu);
+
+  if (result) {
+    pthread_mutex_destroy(&sub->mu);
+  }
   return result;
 }
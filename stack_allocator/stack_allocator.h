@@ -1,4 +1,5 @@
 #ifndef STACK_ALLOCATOR_H
+#define STACK_ALLOCATOR_H
 
 #include <stdbool.h>
 #include <pthread.h>
@@ -10,22 +11,49 @@
 #endif
 
 #define EXPECT(result, expected, msg) do { \
-  if(result != expected) { \
+  if((result) != (expected)) { \
     fprintf(stderr, "DEBUG: %s\n",msg); \
     exit(EXIT_FAILURE); \
    } \
 } while(0) \
 
+/*
+ * init_allocator_with_flags() options.
+ * ALLOCATOR_HUGEPAGE: madvise(MADV_HUGEPAGE); the mapping is shared, so the
+ *                     flag is dropped unless shmem THP is at least "advise".
+ *                     Even then the kernel may still back the region with
+ *                     4k pages; /proc/self/smaps has the final word.
+ * ALLOCATOR_HUGETLB:  MAP_HUGETLB, falls back to normal pages when no huge
+ *                     pages are reserved. The length is rounded up to
+ *                     HUGE_PAGE_SIZE.
+ * ALLOCATOR_POPULATE: MAP_POPULATE, pre-fault the whole region up front.
+ * ALLOCATOR_READONLY is set on read-only snapshots, see stack_snapshot.h.
+ * The flags that were applied are kept in stackAllocator.flags.
+ */
+#define ALLOCATOR_HUGEPAGE 0x1
+#define ALLOCATOR_HUGETLB  0x2
+#define ALLOCATOR_POPULATE 0x4
+#define ALLOCATOR_READONLY 0x8
+
+#define HUGE_PAGE_SIZE (2UL << 20)
+
+/*
+ * Links are offsets from base_addr so the region stays position
+ * independent. An older state always lies above a newer one, so a next
+ * offset of 0 means there is none.
+ */
 struct allocate_state {
-  struct allocate_state *next;
-  char *addr;
+  size_t next;
+  size_t offset;
   size_t n;
 };
 
 struct stackAllocator {
+  char *base_addr;
   char *top_addr;
   char *bottom_addr;
   size_t length;
+  int flags;
   struct allocate_state *head;
   pthread_mutex_t mu;
 };
@@ -36,7 +64,26 @@ struct game_resource {
 };
 
 extern bool init_allocator(struct stackAllocator *allocator, size_t length);
+extern bool init_allocator_with_flags(struct stackAllocator *allocator, size_t length, int flags);
 extern void *allocate(struct stackAllocator *allocator, size_t n);
 extern bool deallocate(struct stackAllocator *allocator, void *addr);
+extern bool reset_allocator(struct stackAllocator *allocator);
+extern bool destroy_allocator(struct stackAllocator *allocator);
+
+/*
+ * Per-thread sub allocators. A slice of the parent is granted under the
+ * parent lock; the owning thread then uses the *_unlocked calls on it
+ * without any synchronization. Slices are returned to the parent in LIFO
+ * order like any other allocation, with release_sub_allocator() only:
+ * a slice is not a mapping of its own, so never pass it to
+ * destroy_allocator(), even though it inherits the parent's flags.
+ * Slice base and length are rounded to SUB_ALLOCATOR_ALIGNMENT.
+ */
+#define SUB_ALLOCATOR_ALIGNMENT 16
+
+extern bool init_sub_allocator(struct stackAllocator *sub, struct stackAllocator *parent, size_t length);
+extern bool release_sub_allocator(struct stackAllocator *sub, struct stackAllocator *parent);
+extern void *allocate_unlocked(struct stackAllocator *allocator, size_t n);
+extern bool deallocate_unlocked(struct stackAllocator *allocator, void *addr);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,295 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <time.h>
+#include "stack_allocator.h"
+
+/*
+ * Multi-threaded allocate/deallocate benchmark, run in rounds. In every
+ * round all threads first allocate a batch of blocks concurrently and
+ * touch them (the allocate phase), then the blocks are freed (the free
+ * phase). Only one phase runs at a time.
+ * Modes:
+ *   locked  all threads share one stackAllocator, so the allocate phase
+ *           measures the contended mutex path. A shared stack can only
+ *           be freed in LIFO order, so in the free phase one thread
+ *           deallocate()s the newest batch, uncontended, and
+ *           reset_allocator() drops the rest
+ *   sub     each thread owns a sub allocator of the same region and
+ *           frees its own batch in LIFO order
+ *   malloc  malloc/free, each thread freeing its own batch
+ * Output is CSV, one row per mode/threads/size/region combination:
+ *   ops, seconds, ops_per_sec  allocations, and wall time summed over
+ *                              the allocate phases only
+ *   alloc_*_ns                 each allocate call, allocate phase
+ *   free_*_ns                  each free call, free phase
+ */
+
+#define BATCH 64
+
+struct bench_thread;
+
+struct bench_config {
+  const char *mode;
+  int threads;
+  size_t size;
+  size_t region;
+  int iters;
+  bool locked;
+  bool sub;
+  int batch;
+  struct bench_thread *workers;
+  long alloc_ns;
+};
+
+/* whole cache lines each, so one thread's fields (sub above all) never share a line with another's */
+struct bench_thread {
+  struct bench_config *config;
+  struct stackAllocator *shared;
+  struct stackAllocator sub;
+  char **blocks;
+  long *alloc_latencies;
+  long *free_latencies;
+  long allocs;
+  long frees;
+  long start;
+  long end;
+  int index;
+  pthread_t thread;
+} __attribute__((aligned(64)));
+
+static pthread_barrier_t phase_barrier;
+
+static long now_ns()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+static char *bench_allocate(struct bench_thread *t, size_t n)
+{
+  if (t->config->locked) {
+    return allocate(t->shared, n);
+  } else if (t->config->sub) {
+    return allocate_unlocked(&t->sub, n);
+  }
+  return malloc(n);
+}
+
+static void bench_free(struct bench_thread *t, char *p)
+{
+  long start = now_ns();
+
+  if (t->config->locked) {
+    EXPECT(deallocate(t->shared, p), true, "deallocate failed");
+  } else if (t->config->sub) {
+    EXPECT(deallocate_unlocked(&t->sub, p), true, "deallocate failed");
+  } else {
+    free(p);
+  }
+  t->free_latencies[t->frees++] = now_ns() - start;
+}
+
+static void *bench_thread(void *arg)
+{
+  struct bench_thread *t = arg;
+  struct bench_config *config = t->config;
+  long start, end;
+  int done, batch, i;
+
+  for (done = 0; done < config->iters; done += batch) {
+    batch = config->iters - done < config->batch ? config->iters - done : config->batch;
+
+    pthread_barrier_wait(&phase_barrier);
+    t->start = now_ns();
+    for (i = 0; i < batch; i++) {
+      start = now_ns();
+      t->blocks[i] = bench_allocate(t, config->size);
+      t->alloc_latencies[t->allocs++] = now_ns() - start;
+      EXPECT(t->blocks[i] != NULL, true, "allocate failed");
+      t->blocks[i][0] = i;
+    }
+    t->end = now_ns();
+    pthread_barrier_wait(&phase_barrier);
+
+    if (t->index == 0) {
+      /* wall time from the first thread starting to the last one finishing */
+      start = t->start;
+      end = t->end;
+      for (i = 1; i < config->threads; i++) {
+        start = config->workers[i].start < start ? config->workers[i].start : start;
+        end = config->workers[i].end > end ? config->workers[i].end : end;
+      }
+      config->alloc_ns += end - start;
+    }
+
+    if (!config->locked) {
+      for (i = batch; i--; ) {
+        bench_free(t, t->blocks[i]);
+      }
+    } else if (t->index == 0) {
+      /* the newest blocks are on top, whoever allocated them */
+      for (i = 0; i < batch; i++) {
+        bench_free(t, t->shared->base_addr + t->shared->head->offset);
+      }
+      EXPECT(reset_allocator(t->shared), true, "reset allocator failed");
+    }
+  }
+
+  return NULL;
+}
+
+static int compare_long(const void *a, const void *b)
+{
+  long x = *(const long *)a, y = *(const long *)b;
+  return (x > y) - (x < y);
+}
+
+static void print_percentiles(long *latencies, long total)
+{
+  qsort(latencies, total, sizeof(long), compare_long);
+  printf(",%ld,%ld,%ld,%ld",
+         latencies[total / 2], latencies[total * 99 / 100],
+         latencies[total * 999 / 1000], latencies[total - 1]);
+}
+
+/* latencies are gathered per thread, then merged for the percentiles */
+static long merge_latencies(long *into, struct bench_thread *threads, int count, bool frees)
+{
+  long total = 0;
+  int i;
+
+  for (i = 0; i < count; i++) {
+    if (frees) {
+      memcpy(into + total, threads[i].free_latencies, threads[i].frees * sizeof(long));
+      total += threads[i].frees;
+    } else {
+      memcpy(into + total, threads[i].alloc_latencies, threads[i].allocs * sizeof(long));
+      total += threads[i].allocs;
+    }
+  }
+  return total;
+}
+
+static void run(struct bench_config *config)
+{
+  struct bench_thread *threads;
+  struct stackAllocator allocator;
+  size_t fits = config->region / (config->threads + 1) / (config->size + sizeof(struct allocate_state));
+  long total = (long)config->threads * config->iters;
+  long *latencies = malloc(total * sizeof(long));
+  long frees;
+  double elapsed;
+  int i;
+
+  /* a batch per thread must fit in the shared region or in a sub allocator */
+  config->batch = fits < BATCH ? fits : BATCH;
+  EXPECT(config->batch > 0, true, "region too small for a batch per thread");
+  config->alloc_ns = 0;
+  config->locked = !strcmp(config->mode, "locked");
+  config->sub = !strcmp(config->mode, "sub");
+
+  if (strcmp(config->mode, "malloc")) {
+    EXPECT(init_allocator(&allocator, config->region), true, "init allocator failed");
+  }
+
+  EXPECT(posix_memalign((void **)&threads, 64, config->threads * sizeof(struct bench_thread)), 0,
+         "allocate threads failed");
+  config->workers = threads;
+  pthread_barrier_init(&phase_barrier, NULL, config->threads);
+  for (i = 0; i < config->threads; i++) {
+    threads[i].config = config;
+    threads[i].shared = &allocator;
+    threads[i].index = i;
+    threads[i].blocks = malloc(config->batch * sizeof(char *));
+    threads[i].alloc_latencies = malloc(config->iters * sizeof(long));
+    threads[i].free_latencies = malloc(config->iters * sizeof(long));
+    threads[i].allocs = 0;
+    threads[i].frees = 0;
+    if (config->sub) {
+      EXPECT(init_sub_allocator(&threads[i].sub, &allocator, config->region / (config->threads + 1)),
+             true, "init sub allocator failed");
+    }
+  }
+  for (i = 0; i < config->threads; i++) {
+    pthread_create(&threads[i].thread, NULL, bench_thread, &threads[i]);
+  }
+  for (i = 0; i < config->threads; i++) {
+    pthread_join(threads[i].thread, NULL);
+  }
+  pthread_barrier_destroy(&phase_barrier);
+  elapsed = config->alloc_ns / 1e9;
+
+  printf("%s,%d,%zu,%zu,%ld,%.6f,%.0f",
+         config->mode, config->threads, config->size, config->region, total,
+         elapsed, total / elapsed);
+  print_percentiles(latencies, merge_latencies(latencies, threads, config->threads, false));
+  frees = merge_latencies(latencies, threads, config->threads, true);
+  print_percentiles(latencies, frees);
+  printf("\n");
+  fflush(stdout);
+
+  for (i = 0; i < config->threads; i++) {
+    free(threads[i].blocks);
+    free(threads[i].alloc_latencies);
+    free(threads[i].free_latencies);
+  }
+  free(threads);
+  free(latencies);
+  if (strcmp(config->mode, "malloc")) {
+    destroy_allocator(&allocator);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  static const char *modes[] = { "locked", "sub", "malloc" };
+  static const size_t sizes[] = { 16, 256, 4096 };
+  static const size_t regions[] = { 1 << 20, 64 << 20 };
+  struct bench_config config;
+  int max_threads = sysconf(_SC_NPROCESSORS_ONLN);
+  int iters = 100000;
+  int m, s, r, threads, i;
+
+  for (i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--threads") && i+1 < argc) {
+      max_threads = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--iters") && i+1 < argc) {
+      iters = atoi(argv[++i]);
+    } else {
+      fprintf(stderr, "usage: %s [--threads N] [--iters N]\n", argv[0]);
+      exit(1);
+    }
+  }
+  if (max_threads < 1 || iters < 1) {
+    fprintf(stderr, "%s: --threads and --iters must be positive\n", argv[0]);
+    exit(1);
+  }
+
+  printf("mode,threads,size,region,ops,seconds,ops_per_sec,"
+         "alloc_p50_ns,alloc_p99_ns,alloc_p999_ns,alloc_max_ns,"
+         "free_p50_ns,free_p99_ns,free_p999_ns,free_max_ns\n");
+
+  config.iters = iters;
+  for (m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+    config.mode = modes[m];
+    for (r = 0; r < sizeof(regions) / sizeof(regions[0]); r++) {
+      config.region = regions[r];
+      for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        config.size = sizes[s];
+        for (threads = 1; ; threads *= 2) {
+          config.threads = threads < max_threads ? threads : max_threads;
+          run(&config);
+          if (config.threads == max_threads) {
+            break;
+          }
+        }
+      }
+    }
+  }
+
+  return 0;
+}
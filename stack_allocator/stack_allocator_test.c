@@ -1,8 +1,59 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 #include "stack_allocator.h"
 
+#define THREADS 4
+#define THREAD_ITERS 10000
+
+static void *worker(void *arg)
+{
+  struct stackAllocator *sub = arg;
+  struct game_resource *resource;
+  int i;
+
+  for (i = 0; i < THREAD_ITERS; i++) {
+    resource = allocate_unlocked(sub, sizeof(struct game_resource));
+    EXPECT(resource != NULL, true, "sub allocate failed");
+    resource->level = i;
+    EXPECT(deallocate_unlocked(sub, resource), true, "sub deallocate failed");
+  }
+
+  return NULL;
+}
+
+static void test_sub_allocators()
+{
+  struct stackAllocator allocator;
+  struct stackAllocator subs[THREADS];
+  pthread_t threads[THREADS];
+  int i;
+
+  EXPECT(init_allocator(&allocator, 65536), true, "init allocator failed");
+
+  for (i = 0; i < THREADS; i++) {
+    /* odd sizes keep the parent top unaligned between slices */
+    EXPECT(allocate(&allocator, 3) != NULL, true, "allocate failed");
+    EXPECT(init_sub_allocator(&subs[i], &allocator, 4093), true, "init sub allocator failed");
+    EXPECT((uintptr_t)subs[i].base_addr % SUB_ALLOCATOR_ALIGNMENT, 0, "sub allocator base unaligned");
+    EXPECT(subs[i].length % SUB_ALLOCATOR_ALIGNMENT, 0, "sub allocator length unaligned");
+    pthread_create(&threads[i], NULL, worker, &subs[i]);
+  }
+  for (i = 0; i < THREADS; i++) {
+    pthread_join(threads[i], NULL);
+  }
+
+  /* slices go back to the parent in LIFO order */
+  EXPECT(release_sub_allocator(&subs[0], &allocator), false, "out of order release succeeded");
+  for (i = THREADS; i--; ) {
+    EXPECT(release_sub_allocator(&subs[i], &allocator), true, "release sub allocator failed");
+    EXPECT(deallocate(&allocator, allocator.base_addr + allocator.head->offset), true, "deallocate failed");
+  }
+  EXPECT(allocator.head == NULL, true, "parent not empty");
+  printf("%d sub allocators released\n", THREADS);
+}
+
 int main()
 {
   struct game_resource *resource_a, *resource_b;
@@ -23,5 +74,7 @@ int main()
   EXPECT(deallocate(&allocator, resource_b), true, "deallocate failed");
   EXPECT(deallocate(&allocator, resource_a), true, "deallocate failed");
 
+  test_sub_allocators();
+
   return 0; 
 }
\ No newline at end of file
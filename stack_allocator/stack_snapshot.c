@@ -0,0 +1,179 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "stack_snapshot.h"
+
+static bool write_all(int fd, const char *buf, size_t n, off_t offset)
+{
+  ssize_t written;
+
+  while (n > 0) {
+    written = pwrite(fd, buf, n, offset);
+    if (written < 0) {
+      return false;
+    }
+    buf += written;
+    n -= written;
+    offset += written;
+  }
+  return true;
+}
+
+bool save_allocator(struct stackAllocator *allocator, const char *path)
+{
+  struct snapshot_header header;
+  long ps = getpagesize();
+  bool result = false;
+  int fd;
+
+  pthread_mutex_lock(&allocator->mu);
+
+  header.magic = SNAPSHOT_MAGIC;
+  header.state_size = sizeof(struct allocate_state);
+  header.length = allocator->length;
+  header.top = allocator->top_addr - allocator->base_addr;
+  header.bottom = allocator->bottom_addr - allocator->base_addr;
+  header.head = allocator->head ? (char *)allocator->head - allocator->base_addr : 0;
+
+  fd = open(path, O_RDWR|O_CREAT|O_TRUNC, 0644);
+  if (fd < 0) {
+    perror("save allocator");
+    goto unlock;
+  }
+
+  /* the region starts on the second page so it can be mapped directly;
+     the unused middle is left as a hole in the file */
+  if (!write_all(fd, (char *)&header, sizeof(header), 0)
+      || !write_all(fd, allocator->base_addr, header.top, ps)
+      || !write_all(fd, allocator->bottom_addr, header.length - header.bottom, ps + header.bottom)
+      || ftruncate(fd, ps + header.length) != 0) {
+    perror("save allocator");
+    close(fd);
+    goto unlock;
+  }
+
+  result = close(fd) == 0;
+
+unlock:
+  pthread_mutex_unlock(&allocator->mu);
+
+  return result;
+}
+
+/* a truncated or corrupt file would fault or corrupt memory once touched */
+static bool valid_header(struct snapshot_header *header, off_t file_size, long ps)
+{
+  uint64_t size = sizeof(struct allocate_state);
+
+  if (header->state_size != size) {
+    return false;
+  }
+  if (header->length == 0 || file_size < ps || (uint64_t)(file_size - ps) < header->length) {
+    return false;
+  }
+  if (header->top > header->bottom || header->bottom > header->length
+      || (header->length - header->bottom) % size != 0) {
+    return false;
+  }
+  /* the newest state is the one at the bottom */
+  if (header->bottom < header->length && header->head != header->bottom) {
+    return false;
+  }
+  return true;
+}
+
+/*
+ * Walk the states from the newest (at bottom) to the oldest. Each must
+ * link to the record right above it, and the blocks they describe must
+ * tile [0, top) with no gaps, so deallocate can never move top outside
+ * the mapping.
+ */
+static bool valid_states(struct snapshot_header *header, char *addr)
+{
+  uint64_t size = sizeof(struct allocate_state);
+  uint64_t end = header->top;
+  uint64_t at, expected_next;
+  struct allocate_state *state;
+
+  for (at = header->bottom; at < header->length; at += size) {
+    state = (struct allocate_state *)(addr + at);
+    expected_next = at + size < header->length ? at + size : 0;
+
+    if (state->next != expected_next || state->n > end || state->offset != end - state->n) {
+      return false;
+    }
+    end = state->offset;
+  }
+  return end == 0;
+}
+
+bool load_allocator(struct stackAllocator *allocator, const char *path, int mode)
+{
+  struct snapshot_header header;
+  long ps = getpagesize();
+  int prot = PROT_READ;
+  struct stat st;
+  char *addr;
+  int fd;
+
+  fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    perror("load allocator");
+    return false;
+  }
+  if (pread(fd, &header, sizeof(header), 0) != sizeof(header) || header.magic != SNAPSHOT_MAGIC) {
+    DEBUG("not an allocator snapshot: %s", path);
+    close(fd);
+    return false;
+  }
+  if (fstat(fd, &st) != 0 || !valid_header(&header, st.st_size, ps)) {
+    DEBUG("corrupt allocator snapshot: %s", path);
+    close(fd);
+    return false;
+  }
+
+  if (mode == SNAPSHOT_PRIVATE) {
+    prot |= PROT_WRITE;
+  }
+  addr = (char *)mmap(NULL, header.length, prot, MAP_PRIVATE, fd, ps);
+  close(fd);
+
+  if (addr == MAP_FAILED) {
+    perror("load allocator");
+    return false;
+  }
+  if (!valid_states(&header, addr)) {
+    DEBUG("corrupt allocate states in snapshot: %s", path);
+    munmap(addr, header.length);
+    return false;
+  }
+
+  allocator->length = header.length;
+  allocator->flags = mode == SNAPSHOT_READONLY ? ALLOCATOR_READONLY : 0;
+  allocator->base_addr = addr;
+  allocator->top_addr = addr + header.top;
+  allocator->bottom_addr = addr + header.bottom;
+  allocator->head = header.bottom == header.length ? NULL : (struct allocate_state *)(addr + header.head);
+  pthread_mutex_init(&allocator->mu, NULL);
+
+  return true;
+}
+
+bool unload_allocator(struct stackAllocator *allocator)
+{
+  return munmap(allocator->base_addr, allocator->length) == 0;
+}
+
+size_t allocator_offset(struct stackAllocator *allocator, void *addr)
+{
+  return (char *)addr - allocator->base_addr;
+}
+
+void *allocator_pointer(struct stackAllocator *allocator, size_t offset)
+{
+  return allocator->base_addr + offset;
+}
@@ -0,0 +1,39 @@
+#ifndef STACK_SNAPSHOT_H
+#define STACK_SNAPSHOT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "stack_allocator.h"
+
+/*
+ * Snapshots of a stack allocator. The used prefix and the allocate states
+ * are written to a sparse file which load_allocator() maps back with a
+ * single mmap. The region may land at a different address, so data that
+ * points into it must store offsets (see allocator_offset()).
+ *
+ * SNAPSHOT_PRIVATE maps copy-on-write and the allocator is usable as is;
+ * SNAPSHOT_READONLY maps read-only; allocate(), deallocate() and
+ * reset_allocator() on it always fail. Truncated files and files whose
+ * header or allocate state chain is inconsistent are rejected.
+ */
+#define SNAPSHOT_PRIVATE 0
+#define SNAPSHOT_READONLY 1
+
+#define SNAPSHOT_MAGIC 0x70616e7374616b73ULL
+
+struct snapshot_header {
+  uint64_t magic;
+  uint64_t state_size; /* sizeof(struct allocate_state), guards the layout */
+  uint64_t length;
+  uint64_t top;
+  uint64_t bottom;
+  uint64_t head;
+};
+
+extern bool save_allocator(struct stackAllocator *allocator, const char *path);
+extern bool load_allocator(struct stackAllocator *allocator, const char *path, int mode);
+extern bool unload_allocator(struct stackAllocator *allocator);
+extern size_t allocator_offset(struct stackAllocator *allocator, void *addr);
+extern void *allocator_pointer(struct stackAllocator *allocator, size_t offset);
+
+#endif
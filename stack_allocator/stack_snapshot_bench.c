@@ -0,0 +1,81 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include "stack_snapshot.h"
+
+#define RESOURCES 200000
+#define BLOB_SIZE 1024
+#define REGION_LENGTH ((size_t)RESOURCES * (sizeof(struct game_resource) + BLOB_SIZE + 2 * sizeof(struct allocate_state)) + 4096)
+
+static double now_ms()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+/* stands in for parsing level data at startup */
+static void build_level(struct stackAllocator *allocator)
+{
+  struct game_resource *resource;
+  char *blob;
+  int i;
+
+  for (i = 0; i < RESOURCES; i++) {
+    resource = allocate(allocator, sizeof(struct game_resource));
+    resource->level = i;
+    snprintf(resource->name, sizeof(resource->name), "resource%d", i);
+    blob = allocate(allocator, BLOB_SIZE);
+    memset(blob, i, BLOB_SIZE);
+  }
+}
+
+static long walk_level(struct stackAllocator *allocator)
+{
+  char *p = allocator->base_addr;
+  long sum = 0;
+  int i;
+
+  for (i = 0; i < RESOURCES; i++) {
+    sum += ((struct game_resource *)p)->level;
+    p += sizeof(struct game_resource) + BLOB_SIZE;
+  }
+  return sum;
+}
+
+int main()
+{
+  struct stackAllocator allocator, loaded;
+  char path[] = "/tmp/stack_snapshot_XXXXXX";
+  double build_ms, load_ms, save_ms;
+  long expected;
+
+  close(mkstemp(path));
+
+  build_ms = now_ms();
+  EXPECT(init_allocator(&allocator, REGION_LENGTH), true, "init allocator failed");
+  build_level(&allocator);
+  expected = walk_level(&allocator);
+  build_ms = now_ms() - build_ms;
+
+  save_ms = now_ms();
+  EXPECT(save_allocator(&allocator, path), true, "save allocator failed");
+  save_ms = now_ms() - save_ms;
+
+  load_ms = now_ms();
+  EXPECT(load_allocator(&loaded, path, SNAPSHOT_PRIVATE), true, "load allocator failed");
+  EXPECT(walk_level(&loaded), expected, "snapshot contents differ");
+  load_ms = now_ms() - load_ms;
+
+  printf("%d resources, %.1f MB region\n", RESOURCES, REGION_LENGTH / (1024.0 * 1024.0));
+  printf("build:         %8.2f ms\n", build_ms);
+  printf("save:          %8.2f ms\n", save_ms);
+  printf("load and walk: %8.2f ms\n", load_ms);
+
+  unload_allocator(&loaded);
+  unlink(path);
+
+  return 0;
+}
@@ -0,0 +1,85 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include "stack_snapshot.h"
+
+#define RESOURCES 16
+
+/* the level keeps offsets, not pointers, so it survives being remapped */
+struct level {
+  int count;
+  size_t resources[RESOURCES];
+};
+
+int main()
+{
+  struct stackAllocator allocator, loaded;
+  struct game_resource *resource;
+  struct level *level;
+  char path[] = "/tmp/stack_snapshot_XXXXXX";
+  int i;
+
+  close(mkstemp(path));
+  EXPECT(init_allocator(&allocator, 16384), true, "init allocator failed");
+
+  level = allocate(&allocator, sizeof(struct level));
+  level->count = RESOURCES;
+  for (i = 0; i < RESOURCES; i++) {
+    resource = allocate(&allocator, sizeof(struct game_resource));
+    resource->level = i;
+    sprintf(resource->name, "resource%d", i);
+    level->resources[i] = allocator_offset(&allocator, resource);
+  }
+  EXPECT(save_allocator(&allocator, path), true, "save allocator failed");
+
+  EXPECT(load_allocator(&loaded, path, SNAPSHOT_PRIVATE), true, "load allocator failed");
+  level = allocator_pointer(&loaded, 0);
+  EXPECT(level->count, RESOURCES, "level not restored");
+  for (i = 0; i < RESOURCES; i++) {
+    resource = allocator_pointer(&loaded, level->resources[i]);
+    EXPECT(resource->level, i, "resource not restored");
+  }
+  printf("%s restored\n", resource->name);
+
+  /* the loaded allocator carries on where the saved one stopped */
+  resource = allocate(&loaded, sizeof(struct game_resource));
+  EXPECT(resource != NULL, true, "allocate after load failed");
+  EXPECT(deallocate(&loaded, resource), true, "deallocate after load failed");
+  for (i = RESOURCES; i--; ) {
+    EXPECT(deallocate(&loaded, allocator_pointer(&loaded, level->resources[i])), true, "deallocate restored failed");
+  }
+  EXPECT(unload_allocator(&loaded), true, "unload allocator failed");
+
+  EXPECT(load_allocator(&loaded, path, SNAPSHOT_READONLY), true, "load read only failed");
+  EXPECT(allocate(&loaded, 1) == NULL, true, "read only allocate succeeded");
+  level = allocator_pointer(&loaded, 0);
+  resource = allocator_pointer(&loaded, level->resources[RESOURCES - 1]);
+  EXPECT(deallocate(&loaded, resource), false, "read only deallocate succeeded");
+  EXPECT(reset_allocator(&loaded), false, "read only reset succeeded");
+  EXPECT(unload_allocator(&loaded), true, "unload allocator failed");
+
+  /* a state whose size points outside the region is rejected */
+  {
+    struct snapshot_header header;
+    struct allocate_state state;
+    long ps = getpagesize();
+    int fd = open(path, O_RDWR);
+
+    EXPECT(pread(fd, &header, sizeof(header), 0), (ssize_t)sizeof(header), "read header failed");
+    EXPECT(pread(fd, &state, sizeof(state), ps + header.head), (ssize_t)sizeof(state), "read state failed");
+    state.n = 1ULL << 40;
+    EXPECT(pwrite(fd, &state, sizeof(state), ps + header.head), (ssize_t)sizeof(state), "write state failed");
+    close(fd);
+  }
+  EXPECT(load_allocator(&loaded, path, SNAPSHOT_PRIVATE), false, "corrupt state loaded");
+
+  /* a truncated snapshot is rejected instead of faulting later */
+  EXPECT(truncate(path, 8192), 0, "truncate failed");
+  EXPECT(load_allocator(&loaded, path, SNAPSHOT_PRIVATE), false, "truncated snapshot loaded");
+
+  unlink(path);
+
+  return 0;
+}